@@ -0,0 +1,107 @@
+/*
+Licensed under the MIT License <http://opensource.org/licenses/MIT>.
+SPDX-License-Identifier: MIT
+Copyright (c) 2020-2026 djcj@gmx.de
+
+Permission is hereby  granted, free of charge, to any  person obtaining a copy
+of this software and associated  documentation files (the "Software"), to deal
+in the Software  without restriction, including without  limitation the rights
+to  use, copy,  modify, merge,  publish, distribute,  sublicense, and/or  sell
+copies  of  the Software,  and  to  permit persons  to  whom  the Software  is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE  IS PROVIDED "AS  IS", WITHOUT WARRANTY  OF ANY KIND,  EXPRESS OR
+IMPLIED,  INCLUDING BUT  NOT  LIMITED TO  THE  WARRANTIES OF  MERCHANTABILITY,
+FITNESS FOR  A PARTICULAR PURPOSE AND  NONINFRINGEMENT. IN NO EVENT  SHALL THE
+AUTHORS  OR COPYRIGHT  HOLDERS  BE  LIABLE FOR  ANY  CLAIM,  DAMAGES OR  OTHER
+LIABILITY, WHETHER IN AN ACTION OF  CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE  OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/**
+ * Fixed-capacity queue for passing work between pipeline stages; push()
+ * blocks while the queue is full, pop() while it is empty. Once close()
+ * was called, pop() drains the remaining items and then returns false.
+ */
+
+#pragma once
+
+#include <deque>
+#include "compat_thread.hpp"
+
+
+template<class T>
+class bounded_queue
+{
+private:
+
+	std::deque<T> m_items;
+	size_t m_capacity;
+	bool m_closed = false;
+	compat_mutex m_lock;
+	compat_cond m_notfull;
+	compat_cond m_notempty;
+
+
+public:
+
+	bounded_queue(size_t capacity)
+	: m_capacity(capacity ? capacity : 1)
+	{}
+
+	// returns false if the queue was closed
+	bool push(const T &item)
+	{
+		m_lock.lock();
+
+		while (m_items.size() >= m_capacity && !m_closed) {
+			m_notfull.wait(m_lock);
+		}
+
+		if (m_closed) {
+			m_lock.unlock();
+			return false;
+		}
+
+		m_items.push_back(item);
+		m_lock.unlock();
+		m_notempty.notify_one();
+
+		return true;
+	}
+
+	// returns false if the queue is closed and empty
+	bool pop(T &item)
+	{
+		m_lock.lock();
+
+		while (m_items.empty() && !m_closed) {
+			m_notempty.wait(m_lock);
+		}
+
+		if (m_items.empty()) {
+			m_lock.unlock();
+			return false;
+		}
+
+		item = m_items.front();
+		m_items.pop_front();
+		m_lock.unlock();
+		m_notfull.notify_one();
+
+		return true;
+	}
+
+	void close()
+	{
+		m_lock.lock();
+		m_closed = true;
+		m_lock.unlock();
+		m_notfull.notify_all();
+		m_notempty.notify_all();
+	}
+};
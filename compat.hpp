@@ -0,0 +1,420 @@
+/*
+Licensed under the MIT License <http://opensource.org/licenses/MIT>.
+SPDX-License-Identifier: MIT
+Copyright (c) 2020-2026 djcj@gmx.de
+
+Permission is hereby  granted, free of charge, to any  person obtaining a copy
+of this software and associated  documentation files (the "Software"), to deal
+in the Software  without restriction, including without  limitation the rights
+to  use, copy,  modify, merge,  publish, distribute,  sublicense, and/or  sell
+copies  of  the Software,  and  to  permit persons  to  whom  the Software  is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE  IS PROVIDED "AS  IS", WITHOUT WARRANTY  OF ANY KIND,  EXPRESS OR
+IMPLIED,  INCLUDING BUT  NOT  LIMITED TO  THE  WARRANTIES OF  MERCHANTABILITY,
+FITNESS FOR  A PARTICULAR PURPOSE AND  NONINFRINGEMENT. IN NO EVENT  SHALL THE
+AUTHORS  OR COPYRIGHT  HOLDERS  BE  LIABLE FOR  ANY  CLAIM,  DAMAGES OR  OTHER
+LIABILITY, WHETHER IN AN ACTION OF  CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE  OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/**
+ * Small compatibility layer for the parts of the tools that don't need COM
+ * and can therefore be built natively on other systems as well.
+ */
+
+#pragma once
+
+#ifdef _WIN32
+# include <windows.h>
+# include <shlobj.h>    // SLDF_RUNAS_USER, HOTKEYF_*
+# include <fcntl.h>
+# include <io.h>
+#else
+# include <fcntl.h>
+# include <locale.h>
+# include <stdint.h>
+# include <sys/mman.h>
+# include <sys/stat.h>
+# include <unistd.h>
+# include <wctype.h>
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <wchar.h>
+
+
+#ifndef _WIN32
+
+typedef uint8_t  BYTE;
+typedef uint16_t WORD;
+typedef uint32_t DWORD;
+
+#define wprintf_s   wprintf
+#define fwprintf_s  fwprintf
+#define swscanf_s   swscanf
+#define _wcsicmp    wcscasecmp
+#define _wcsnicmp   wcsncasecmp
+#define _countof(x) (sizeof(x) / sizeof(x[0]))
+
+// values from the Windows SDK that are stored in Shell Link files
+#define SW_SHOWNORMAL       1
+#define SW_SHOWMAXIMIZED    3
+#define SW_SHOWMINNOACTIVE  7
+
+#define HOTKEYF_SHIFT    0x01
+#define HOTKEYF_CONTROL  0x02
+#define HOTKEYF_ALT      0x04
+#define HOTKEYF_EXT      0x08
+
+#define VK_F1       0x70
+#define VK_F24      0x87
+#define VK_NUMLOCK  0x90
+#define VK_SCROLL   0x91
+
+#define SLDF_RUNAS_USER  0x2000
+
+#endif // !_WIN32
+
+
+// Decode UTF-8 into a NUL-terminated wide string (UTF-16 on Windows, UTF-32 elsewhere).
+// Invalid sequences are replaced with U+FFFD, the output is truncated to fit.
+inline size_t compat_utf8_to_wide(const char *in, size_t len, wchar_t *out, size_t outlen)
+{
+	const unsigned char *p = reinterpret_cast<const unsigned char *>(in);
+	const unsigned char *end = p + len;
+	size_t n = 0;
+
+	if (outlen == 0) {
+		return 0;
+	}
+
+	while (p < end && *p != 0) {
+		unsigned long c = *p++;
+		unsigned long min = 0;  // smallest code point of this length, rejects overlong forms
+		int follow = 0;
+
+		if (c >= 0xF0 && c <= 0xF4) {
+			c &= 0x07;
+			min = 0x10000;
+			follow = 3;
+		} else if (c >= 0xE0 && c <= 0xEF) {
+			c &= 0x0F;
+			min = 0x800;
+			follow = 2;
+		} else if (c >= 0xC2 && c < 0xE0) {
+			c &= 0x1F;
+			follow = 1;
+		} else if (c >= 0x80) {
+			c = 0xFFFD;
+		}
+
+		for ( ; follow > 0; --follow) {
+			if (p >= end || (*p & 0xC0) != 0x80) {
+				c = 0xFFFD;
+				break;
+			}
+			c = (c << 6) | (*p++ & 0x3F);
+		}
+
+		if (c < min || c > 0x10FFFF || (c >= 0xD800 && c <= 0xDFFF)) {
+			c = 0xFFFD;
+		}
+
+		if (sizeof(wchar_t) == 2 && c > 0xFFFF) {
+			if (n + 2 >= outlen) break;
+			c -= 0x10000;
+			out[n++] = static_cast<wchar_t>(0xD800 | (c >> 10));
+			out[n++] = static_cast<wchar_t>(0xDC00 | (c & 0x3FF));
+		} else {
+			if (n + 1 >= outlen) break;
+			out[n++] = static_cast<wchar_t>(c);
+		}
+	}
+
+	out[n] = 0;
+
+	return n;
+}
+
+// Decode little endian UTF-16 (as stored in Shell Link files) into a NUL-terminated
+// wide string; stops at the first NUL character, the output is truncated to fit.
+inline size_t compat_utf16le_to_wide(const unsigned char *in, size_t nchars, wchar_t *out, size_t outlen)
+{
+	size_t n = 0;
+
+	if (outlen == 0) {
+		return 0;
+	}
+
+	for (size_t i = 0; i < nchars && n + 1 < outlen; ++i) {
+		unsigned long c = in[i*2] | (in[i*2 + 1] << 8);
+
+		if (c == 0) {
+			break;
+		}
+
+		if (sizeof(wchar_t) == 4 && c >= 0xD800 && c <= 0xDBFF && i + 1 < nchars) {
+			unsigned long lo = in[i*2 + 2] | (in[i*2 + 3] << 8);
+
+			if (lo >= 0xDC00 && lo <= 0xDFFF) {
+				c = 0x10000 + ((c - 0xD800) << 10) + (lo - 0xDC00);
+				++i;
+			}
+		}
+
+		out[n++] = static_cast<wchar_t>(c);
+	}
+
+	out[n] = 0;
+
+	return n;
+}
+
+// Encode a wide string as NUL-terminated UTF-8; the output is truncated to fit.
+inline size_t compat_wide_to_utf8(const wchar_t *in, char *out, size_t outlen)
+{
+	size_t n = 0;
+
+	if (outlen == 0) {
+		return 0;
+	}
+
+	for ( ; *in != 0; ++in) {
+		unsigned long c = static_cast<unsigned long>(*in);
+		char tmp[4];
+		size_t len;
+
+		if (sizeof(wchar_t) == 2 && c >= 0xD800 && c <= 0xDBFF &&
+			in[1] >= 0xDC00 && in[1] <= 0xDFFF)
+		{
+			c = 0x10000 + ((c - 0xD800) << 10) + (static_cast<unsigned long>(in[1]) - 0xDC00);
+			++in;
+		}
+
+		if (c < 0x80) {
+			tmp[0] = static_cast<char>(c);
+			len = 1;
+		} else if (c < 0x800) {
+			tmp[0] = static_cast<char>(0xC0 | (c >> 6));
+			tmp[1] = static_cast<char>(0x80 | (c & 0x3F));
+			len = 2;
+		} else if (c < 0x10000) {
+			tmp[0] = static_cast<char>(0xE0 | (c >> 12));
+			tmp[1] = static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+			tmp[2] = static_cast<char>(0x80 | (c & 0x3F));
+			len = 3;
+		} else {
+			tmp[0] = static_cast<char>(0xF0 | (c >> 18));
+			tmp[1] = static_cast<char>(0x80 | ((c >> 12) & 0x3F));
+			tmp[2] = static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+			tmp[3] = static_cast<char>(0x80 | (c & 0x3F));
+			len = 4;
+		}
+
+		if (n + len >= outlen) {
+			break;
+		}
+
+		memcpy(out + n, tmp, len);
+		n += len;
+	}
+
+	out[n] = 0;
+
+	return n;
+}
+
+// _wfopen() that also works where file names are UTF-8 encoded byte strings
+inline FILE *compat_wfopen(const wchar_t *path, const wchar_t *mode)
+{
+#ifdef _WIN32
+	FILE *fp = NULL;
+	return (_wfopen_s(&fp, path, mode) == 0) ? fp : NULL;
+#else
+	char bpath[4096];
+	char bmode[16];
+
+	compat_wide_to_utf8(path, bpath, sizeof(bpath));
+	compat_wide_to_utf8(mode, bmode, sizeof(bmode));
+
+	return fopen(bpath, bmode);
+#endif
+}
+
+// switch a standard stream into binary mode (no-op outside of Windows)
+inline void compat_set_binary(FILE *fp)
+{
+#ifdef _WIN32
+	_setmode(_fileno(fp), _O_BINARY);
+#else
+	(void)fp;
+#endif
+}
+
+// read-only memory mapping of a whole file
+class compat_mapped_file
+{
+private:
+
+	const unsigned char *m_data = NULL;
+	unsigned long long m_size = 0;
+#ifdef _WIN32
+	HANDLE m_file = INVALID_HANDLE_VALUE;
+	HANDLE m_mapping = NULL;
+#endif
+
+
+public:
+
+	compat_mapped_file()
+	{}
+
+	~compat_mapped_file() {
+		close();
+	}
+
+	void close()
+	{
+#ifdef _WIN32
+		if (m_data) UnmapViewOfFile(m_data);
+		if (m_mapping) CloseHandle(m_mapping);
+		if (m_file != INVALID_HANDLE_VALUE) CloseHandle(m_file);
+		m_mapping = NULL;
+		m_file = INVALID_HANDLE_VALUE;
+#else
+		if (m_data) munmap(const_cast<unsigned char *>(m_data), m_size);
+#endif
+		m_data = NULL;
+		m_size = 0;
+	}
+
+	// empty files can be opened but have no data
+	bool open(const wchar_t *path)
+	{
+		close();
+
+#ifdef _WIN32
+		LARGE_INTEGER li;
+
+		m_file = CreateFileW(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+							FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+
+		if (m_file == INVALID_HANDLE_VALUE || !GetFileSizeEx(m_file, &li)) {
+			close();
+			return false;
+		}
+
+		if (li.QuadPart == 0) {
+			return true;
+		}
+
+		// the whole file must fit into the address space
+		if (sizeof(void *) < 8 && li.QuadPart > 0x7FFFFFFF) {
+			close();
+			return false;
+		}
+
+		m_mapping = CreateFileMappingW(m_file, NULL, PAGE_READONLY, 0, 0, NULL);
+
+		if (!m_mapping ||
+			(m_data = static_cast<const unsigned char *>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0))) == NULL)
+		{
+			close();
+			return false;
+		}
+
+		m_size = li.QuadPart;
+#else
+		char bpath[4096];
+		struct stat st;
+
+		compat_wide_to_utf8(path, bpath, sizeof(bpath));
+
+		int fd = ::open(bpath, O_RDONLY);
+
+		if (fd == -1) {
+			return false;
+		}
+
+		if (fstat(fd, &st) == -1) {
+			::close(fd);
+			return false;
+		}
+
+		if (st.st_size == 0) {
+			::close(fd);
+			return true;
+		}
+
+		void *p = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		::close(fd);
+
+		if (p == MAP_FAILED) {
+			return false;
+		}
+
+		m_data = static_cast<const unsigned char *>(p);
+		m_size = st.st_size;
+#endif
+
+		return true;
+	}
+
+	const unsigned char *data() const {
+		return m_data;
+	}
+
+	unsigned long long size() const {
+		return m_size;
+	}
+
+	// tell the system how the mapping will be accessed (no-op on Windows)
+	void advise_sequential() const
+	{
+#ifndef _WIN32
+		if (m_data) madvise(const_cast<unsigned char *>(m_data), m_size, MADV_SEQUENTIAL);
+#endif
+	}
+};
+
+#ifndef _WIN32
+// Calls wmain() with the command line converted to wide strings;
+// used as the body of main() on systems that don't have wmain().
+inline int compat_main(int argc, char *argv[], int (*wmain_fn)(int, wchar_t **))
+{
+	wchar_t **wargv = static_cast<wchar_t **>(calloc(argc + 1, sizeof(wchar_t *)));
+	int ret;
+
+	setlocale(LC_ALL, "");
+
+	if (!wargv) {
+		return 1;
+	}
+
+	for (int i = 0; i < argc; ++i) {
+		size_t len = strlen(argv[i]) + 1;
+		wargv[i] = static_cast<wchar_t *>(malloc(len * sizeof(wchar_t)));
+
+		if (!wargv[i]) {
+			return 1;
+		}
+
+		compat_utf8_to_wide(argv[i], len, wargv[i], len);
+	}
+
+	ret = wmain_fn(argc, wargv);
+
+	for (int i = 0; i < argc; ++i) {
+		free(wargv[i]);
+	}
+	free(wargv);
+
+	return ret;
+}
+#endif
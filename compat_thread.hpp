@@ -0,0 +1,170 @@
+/*
+Licensed under the MIT License <http://opensource.org/licenses/MIT>.
+SPDX-License-Identifier: MIT
+Copyright (c) 2020-2026 djcj@gmx.de
+
+Permission is hereby  granted, free of charge, to any  person obtaining a copy
+of this software and associated  documentation files (the "Software"), to deal
+in the Software  without restriction, including without  limitation the rights
+to  use, copy,  modify, merge,  publish, distribute,  sublicense, and/or  sell
+copies  of  the Software,  and  to  permit persons  to  whom  the Software  is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE  IS PROVIDED "AS  IS", WITHOUT WARRANTY  OF ANY KIND,  EXPRESS OR
+IMPLIED,  INCLUDING BUT  NOT  LIMITED TO  THE  WARRANTIES OF  MERCHANTABILITY,
+FITNESS FOR  A PARTICULAR PURPOSE AND  NONINFRINGEMENT. IN NO EVENT  SHALL THE
+AUTHORS  OR COPYRIGHT  HOLDERS  BE  LIABLE FOR  ANY  CLAIM,  DAMAGES OR  OTHER
+LIABILITY, WHETHER IN AN ACTION OF  CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE  OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/**
+ * Minimal threading primitives on top of the Win32 API and pthreads.
+ * std::thread isn't available with MinGW toolchains that use the win32
+ * thread model, so the tools use these instead.
+ */
+
+#pragma once
+
+#ifdef _WIN32
+# include <windows.h>
+#else
+# include <pthread.h>
+# include <unistd.h>
+#endif
+
+
+class compat_thread
+{
+private:
+
+	void (*m_fn)(void *) = NULL;
+	void *m_arg = NULL;
+#ifdef _WIN32
+	HANDLE m_handle = NULL;
+
+	static DWORD WINAPI trampoline(LPVOID p) {
+		compat_thread *t = static_cast<compat_thread *>(p);
+		t->m_fn(t->m_arg);
+		return 0;
+	}
+#else
+	pthread_t m_handle;
+	bool m_running = false;
+
+	static void *trampoline(void *p) {
+		compat_thread *t = static_cast<compat_thread *>(p);
+		t->m_fn(t->m_arg);
+		return NULL;
+	}
+#endif
+
+
+public:
+
+	compat_thread()
+	{}
+
+	~compat_thread() {
+		join();
+	}
+
+	bool start(void (*fn)(void *), void *arg)
+	{
+		m_fn = fn;
+		m_arg = arg;
+#ifdef _WIN32
+		m_handle = CreateThread(NULL, 0, trampoline, this, 0, NULL);
+		return (m_handle != NULL);
+#else
+		m_running = (pthread_create(&m_handle, NULL, trampoline, this) == 0);
+		return m_running;
+#endif
+	}
+
+	void join()
+	{
+#ifdef _WIN32
+		if (m_handle) {
+			WaitForSingleObject(m_handle, INFINITE);
+			CloseHandle(m_handle);
+			m_handle = NULL;
+		}
+#else
+		if (m_running) {
+			pthread_join(m_handle, NULL);
+			m_running = false;
+		}
+#endif
+	}
+};
+
+
+class compat_mutex
+{
+	friend class compat_cond;
+
+private:
+
+#ifdef _WIN32
+	SRWLOCK m_lock = SRWLOCK_INIT;
+#else
+	pthread_mutex_t m_lock = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+
+public:
+
+#ifdef _WIN32
+	void lock() { AcquireSRWLockExclusive(&m_lock); }
+	void unlock() { ReleaseSRWLockExclusive(&m_lock); }
+#else
+	~compat_mutex() { pthread_mutex_destroy(&m_lock); }
+	void lock() { pthread_mutex_lock(&m_lock); }
+	void unlock() { pthread_mutex_unlock(&m_lock); }
+#endif
+};
+
+
+class compat_cond
+{
+private:
+
+#ifdef _WIN32
+	CONDITION_VARIABLE m_cond = CONDITION_VARIABLE_INIT;
+#else
+	pthread_cond_t m_cond = PTHREAD_COND_INITIALIZER;
+#endif
+
+
+public:
+
+#ifdef _WIN32
+	void wait(compat_mutex &m) { SleepConditionVariableSRW(&m_cond, &m.m_lock, INFINITE, 0); }
+	void notify_one() { WakeConditionVariable(&m_cond); }
+	void notify_all() { WakeAllConditionVariable(&m_cond); }
+#else
+	~compat_cond() { pthread_cond_destroy(&m_cond); }
+	void wait(compat_mutex &m) { pthread_cond_wait(&m_cond, &m.m_lock); }
+	void notify_one() { pthread_cond_signal(&m_cond); }
+	void notify_all() { pthread_cond_broadcast(&m_cond); }
+#endif
+};
+
+
+// number of logical processors
+inline unsigned compat_cpu_count()
+{
+#ifdef _WIN32
+	SYSTEM_INFO si;
+	GetSystemInfo(&si);
+	return (si.dwNumberOfProcessors > 0) ? si.dwNumberOfProcessors : 1;
+#else
+	long n = sysconf(_SC_NPROCESSORS_ONLN);
+	return (n > 0) ? static_cast<unsigned>(n) : 1;
+#endif
+}
@@ -0,0 +1,141 @@
+/*
+Licensed under the MIT License <http://opensource.org/licenses/MIT>.
+SPDX-License-Identifier: MIT
+Copyright (c) 2020-2026 djcj@gmx.de
+
+Permission is hereby  granted, free of charge, to any  person obtaining a copy
+of this software and associated  documentation files (the "Software"), to deal
+in the Software  without restriction, including without  limitation the rights
+to  use, copy,  modify, merge,  publish, distribute,  sublicense, and/or  sell
+copies  of  the Software,  and  to  permit persons  to  whom  the Software  is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE  IS PROVIDED "AS  IS", WITHOUT WARRANTY  OF ANY KIND,  EXPRESS OR
+IMPLIED,  INCLUDING BUT  NOT  LIMITED TO  THE  WARRANTIES OF  MERCHANTABILITY,
+FITNESS FOR  A PARTICULAR PURPOSE AND  NONINFRINGEMENT. IN NO EVENT  SHALL THE
+AUTHORS  OR COPYRIGHT  HOLDERS  BE  LIABLE FOR  ANY  CLAIM,  DAMAGES OR  OTHER
+LIABILITY, WHETHER IN AN ACTION OF  CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE  OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/**
+ * Translate Windows paths stored in Shell Links into local paths, e.g.
+ * "C:\Program Files" -> "/home/user/.wine/drive_c/Program Files".
+ *
+ * Mappings are given as "PREFIX=DIRECTORY", where PREFIX is a drive ("C:")
+ * or any other path prefix ("\\server\share"); prefixes are compared
+ * case-insensitively and '/' and '\' are treated the same.
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include "compat.hpp"
+
+
+class drive_map
+{
+private:
+
+	struct mapping
+	{
+		std::wstring prefix;
+		std::wstring target;
+	};
+
+	std::vector<mapping> m_map;
+
+	static bool is_sep(wchar_t c) {
+		return (c == L'\\' || c == L'/');
+	}
+
+
+public:
+
+	// add a mapping in the form "PREFIX=DIRECTORY"
+	bool add(const wchar_t *spec)
+	{
+		const wchar_t *eq = spec ? wcschr(spec, L'=') : NULL;
+		mapping m;
+
+		if (!eq || eq == spec || eq[1] == 0) {
+			return false;
+		}
+
+		m.prefix.assign(spec, eq - spec);
+		m.target.assign(eq + 1);
+
+		while (m.prefix.size() > 1 && is_sep(m.prefix[m.prefix.size() - 1])) {
+			m.prefix.erase(m.prefix.size() - 1);
+		}
+		while (m.target.size() > 1 && is_sep(m.target[m.target.size() - 1])) {
+			m.target.erase(m.target.size() - 1);
+		}
+
+		// longer prefixes first, so "C:\Users" wins over "C:"
+		std::vector<mapping>::iterator it = m_map.begin();
+		while (it != m_map.end() && it->prefix.size() >= m.prefix.size()) {
+			++it;
+		}
+		m_map.insert(it, m);
+
+		return true;
+	}
+
+	bool empty() const {
+		return m_map.empty();
+	}
+
+	// Translate a Windows path; paths without a matching prefix are returned
+	// unchanged on Windows and rejected elsewhere (they can't be local paths).
+	bool translate(const wchar_t *path, std::wstring &out) const
+	{
+#ifdef _WIN32
+		const wchar_t sep = L'\\';
+#else
+		const wchar_t sep = L'/';
+#endif
+
+		for (size_t i = 0; i < m_map.size(); ++i) {
+			const std::wstring &prefix = m_map[i].prefix;
+			size_t k = 0;
+
+			for ( ; k < prefix.size() && path[k] != 0; ++k) {
+				if (!(is_sep(prefix[k]) && is_sep(path[k])) &&
+					towlower(prefix[k]) != towlower(path[k]))
+				{
+					break;
+				}
+			}
+
+			if (k < prefix.size() || (path[k] != 0 && !is_sep(path[k]))) {
+				continue;
+			}
+
+			out = m_map[i].target;
+
+			for ( ; path[k] != 0; ++k) {
+				out += is_sep(path[k]) ? sep : path[k];
+			}
+
+			return true;
+		}
+
+#ifdef _WIN32
+		out = path;
+		return true;
+#else
+		// paths that already look local
+		if (path[0] == L'/') {
+			out = path;
+			return true;
+		}
+		return false;
+#endif
+	}
+};
@@ -0,0 +1,189 @@
+/*
+Licensed under the MIT License <http://opensource.org/licenses/MIT>.
+SPDX-License-Identifier: MIT
+Copyright (c) 2020-2026 djcj@gmx.de
+
+Permission is hereby  granted, free of charge, to any  person obtaining a copy
+of this software and associated  documentation files (the "Software"), to deal
+in the Software  without restriction, including without  limitation the rights
+to  use, copy,  modify, merge,  publish, distribute,  sublicense, and/or  sell
+copies  of  the Software,  and  to  permit persons  to  whom  the Software  is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE  IS PROVIDED "AS  IS", WITHOUT WARRANTY  OF ANY KIND,  EXPRESS OR
+IMPLIED,  INCLUDING BUT  NOT  LIMITED TO  THE  WARRANTIES OF  MERCHANTABILITY,
+FITNESS FOR  A PARTICULAR PURPOSE AND  NONINFRINGEMENT. IN NO EVENT  SHALL THE
+AUTHORS  OR COPYRIGHT  HOLDERS  BE  LIABLE FOR  ANY  CLAIM,  DAMAGES OR  OTHER
+LIABILITY, WHETHER IN AN ACTION OF  CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE  OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/**
+ * Collect Shell Link files from the command line: files are taken as they
+ * are, directories are searched recursively for files ending on .lnk.
+ * Symbolic links to directories are not followed.
+ *
+ * Also contains a helper to read a whole (small) file into memory.
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include "compat.hpp"
+#ifndef _WIN32
+# include <dirent.h>
+#endif
+
+
+inline bool is_lnk_filename(const wchar_t *name)
+{
+	size_t len = wcslen(name);
+	return (len >= 4 && _wcsicmp(name + len - 4, L".lnk") == 0);
+}
+
+// Call fn(const std::wstring &) for path or, if it is a directory, for every
+// Shell Link below it; returns false if path doesn't exist.
+template<class F>
+bool walk_lnk_files(const wchar_t *path, F fn)
+{
+#ifdef _WIN32
+	DWORD attr = GetFileAttributesW(path);
+
+	if (attr == INVALID_FILE_ATTRIBUTES) {
+		return false;
+	}
+
+	if ((attr & FILE_ATTRIBUTE_DIRECTORY) == 0) {
+		fn(std::wstring(path));
+		return true;
+	}
+
+	std::vector<std::wstring> dirs(1, path);
+
+	while (!dirs.empty()) {
+		std::wstring dir = dirs.back();
+		WIN32_FIND_DATAW fd;
+
+		dirs.pop_back();
+
+		HANDLE h = FindFirstFileExW((dir + L"\\*").c_str(), FindExInfoBasic, &fd,
+									FindExSearchNameMatch, NULL, FIND_FIRST_EX_LARGE_FETCH);
+
+		if (h == INVALID_HANDLE_VALUE) {
+			continue;
+		}
+
+		do {
+			if (wcscmp(fd.cFileName, L".") == 0 || wcscmp(fd.cFileName, L"..") == 0) {
+				continue;
+			}
+
+			if (fd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) {
+				if ((fd.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT) == 0) {
+					dirs.push_back(dir + L"\\" + fd.cFileName);
+				}
+			} else if (is_lnk_filename(fd.cFileName)) {
+				fn(dir + L"\\" + fd.cFileName);
+			}
+		} while (FindNextFileW(h, &fd));
+
+		FindClose(h);
+	}
+#else
+	char bpath[4096];
+	struct stat st;
+
+	compat_wide_to_utf8(path, bpath, sizeof(bpath));
+
+	if (stat(bpath, &st) == -1) {
+		return false;
+	}
+
+	if (!S_ISDIR(st.st_mode)) {
+		fn(std::wstring(path));
+		return true;
+	}
+
+	std::vector<std::string> dirs(1, bpath);
+	wchar_t wname[4096];
+
+	while (!dirs.empty()) {
+		std::string dir = dirs.back();
+		DIR *d = opendir(dir.c_str());
+		struct dirent *e;
+
+		dirs.pop_back();
+
+		if (!d) {
+			continue;
+		}
+
+		while ((e = readdir(d)) != NULL) {
+			if (strcmp(e->d_name, ".") == 0 || strcmp(e->d_name, "..") == 0) {
+				continue;
+			}
+
+			std::string sub = dir + "/" + e->d_name;
+			bool isdir = (e->d_type == DT_DIR);
+
+			if (e->d_type == DT_UNKNOWN) {
+				isdir = (lstat(sub.c_str(), &st) == 0 && S_ISDIR(st.st_mode));
+			}
+
+			if (isdir) {
+				dirs.push_back(sub);
+				continue;
+			}
+
+			compat_utf8_to_wide(sub.c_str(), sub.size(), wname, _countof(wname));
+
+			if (is_lnk_filename(wname)) {
+				fn(std::wstring(wname));
+			}
+		}
+
+		closedir(d);
+	}
+#endif
+
+	return true;
+}
+
+// returns false if path doesn't exist
+inline bool collect_lnk_files(const wchar_t *path, std::vector<std::wstring> &out)
+{
+	return walk_lnk_files(path, [&out](const std::wstring &file) { out.push_back(file); });
+}
+
+// read a whole file; files larger than maxsize are rejected
+inline bool read_whole_file(const wchar_t *path, std::vector<unsigned char> &data,
+							size_t maxsize = 16*1024*1024)
+{
+	FILE *fp = compat_wfopen(path, L"rb");
+	unsigned char tmp[16*1024];
+	size_t n;
+
+	data.clear();
+
+	if (!fp) {
+		return false;
+	}
+
+	while ((n = fread(tmp, 1, sizeof(tmp), fp)) > 0) {
+		if (data.size() + n > maxsize) {
+			fclose(fp);
+			return false;
+		}
+		data.insert(data.end(), tmp, tmp + n);
+	}
+
+	bool err = (ferror(fp) != 0);
+	fclose(fp);
+
+	return !err;
+}
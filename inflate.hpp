@@ -0,0 +1,455 @@
+/*
+Licensed under the MIT License <http://opensource.org/licenses/MIT>.
+SPDX-License-Identifier: MIT
+Copyright (c) 2020-2026 djcj@gmx.de
+
+Permission is hereby  granted, free of charge, to any  person obtaining a copy
+of this software and associated  documentation files (the "Software"), to deal
+in the Software  without restriction, including without  limitation the rights
+to  use, copy,  modify, merge,  publish, distribute,  sublicense, and/or  sell
+copies  of  the Software,  and  to  permit persons  to  whom  the Software  is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE  IS PROVIDED "AS  IS", WITHOUT WARRANTY  OF ANY KIND,  EXPRESS OR
+IMPLIED,  INCLUDING BUT  NOT  LIMITED TO  THE  WARRANTIES OF  MERCHANTABILITY,
+FITNESS FOR  A PARTICULAR PURPOSE AND  NONINFRINGEMENT. IN NO EVENT  SHALL THE
+AUTHORS  OR COPYRIGHT  HOLDERS  BE  LIABLE FOR  ANY  CLAIM,  DAMAGES OR  OTHER
+LIABILITY, WHETHER IN AN ACTION OF  CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE  OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/**
+ * Decoder for raw DEFLATE data (RFC 1951) as stored in zip members. The input
+ * is either in memory or pulled from a callback; the latter is for zip members
+ * written to a pipe, whose compressed size is only known once the final block
+ * was decoded. Output that doesn't fit into the given buffer is decoded through
+ * a 32 KiB window and dropped, so members of any size can be passed over.
+ * Huffman codes are decoded bit by bit (like zlib's puff), which is plenty for
+ * members of a few kilobytes.
+ */
+
+#pragma once
+
+#include <string.h>
+
+
+class raw_inflater
+{
+public:
+
+	// input callback: store up to len bytes in buf and return their number, 0 at the end
+	typedef size_t (*read_fn)(void *ctx, unsigned char *buf, size_t len);
+
+
+private:
+
+	enum {
+		WINDOW = 32768  // farthest distance a DEFLATE match can refer back
+	};
+
+	struct huffman {
+		short count[16];    // number of codes of each length
+		short symbol[288];  // symbols ordered by code
+	};
+
+	const unsigned char *m_in;
+	size_t m_inlen;
+	size_t m_inpos = 0;
+	unsigned long long m_inbase = 0;  // input bytes before m_in, callback only
+	read_fn m_read = NULL;
+	void *m_ctx = NULL;
+	unsigned char m_inbuf[512];
+
+	unsigned char *m_out = NULL;      // the caller's buffer, then m_window
+	size_t m_outlen = 0;
+	unsigned long long m_outpos = 0;  // bytes decoded so far
+	unsigned long long m_mask = ~0ULL;
+	unsigned char m_window[WINDOW];
+
+	unsigned long m_bitbuf = 0;
+	int m_bitcnt = 0;
+	bool m_eof = false;  // ran out of input
+
+
+	// next input byte, -1 at the end
+	int next_byte()
+	{
+		if (m_inpos == m_inlen) {
+			if (!m_read) {
+				return -1;
+			}
+
+			m_inbase += m_inlen;
+			m_in = m_inbuf;
+			m_inpos = 0;
+			m_inlen = m_read(m_ctx, m_inbuf, sizeof(m_inbuf));
+
+			if (m_inlen == 0) {
+				return -1;
+			}
+		}
+
+		return m_in[m_inpos++];
+	}
+
+	// The output buffer is full: continue in the window, which only has to
+	// hold the last WINDOW bytes for matches to refer to.
+	void spill()
+	{
+		for (unsigned long long i = (m_outpos > WINDOW) ? m_outpos - WINDOW : 0; i < m_outpos; ++i) {
+			m_window[i & (WINDOW - 1)] = m_out[i];
+		}
+
+		m_out = m_window;
+		m_mask = WINDOW - 1;
+	}
+
+	void put(unsigned char c)
+	{
+		if (m_outpos == m_outlen && m_out != m_window) {
+			spill();
+		}
+
+		m_out[m_outpos & m_mask] = c;
+		++m_outpos;
+	}
+
+	int bits(int need)
+	{
+		unsigned long val = m_bitbuf;
+
+		while (m_bitcnt < need) {
+			int c = next_byte();
+			if (c < 0) {
+				m_eof = true;
+				return 0;
+			}
+			val |= static_cast<unsigned long>(c) << m_bitcnt;
+			m_bitcnt += 8;
+		}
+
+		m_bitbuf = val >> need;
+		m_bitcnt -= need;
+
+		return static_cast<int>(val & ((1UL << need) - 1));
+	}
+
+	bool stored()
+	{
+		// stored blocks start at a byte boundary
+		m_bitbuf = 0;
+		m_bitcnt = 0;
+
+		int b[4];
+
+		for (int i = 0; i < 4; ++i) {
+			if ((b[i] = next_byte()) < 0) {
+				return false;
+			}
+		}
+
+		size_t len = b[0] | (b[1] << 8);
+		size_t nlen = b[2] | (b[3] << 8);
+
+		if (len != (~nlen & 0xFFFF)) {
+			return false;
+		}
+
+		for (; len > 0; --len) {
+			int c = next_byte();
+
+			if (c < 0) {
+				return false;
+			}
+			put(static_cast<unsigned char>(c));
+		}
+
+		return true;
+	}
+
+	// returns the symbol, or -1 on an invalid code or missing input
+	int decode(const huffman &h)
+	{
+		int code = 0, first = 0, index = 0;
+
+		for (int len = 1; len < 16; ++len) {
+			code |= bits(1);
+
+			if (m_eof) {
+				return -1;
+			}
+
+			int count = h.count[len];
+
+			if (code - count < first) {
+				return h.symbol[index + (code - first)];
+			}
+
+			index += count;
+			first = (first + count) << 1;
+			code <<= 1;
+		}
+
+		return -1;
+	}
+
+	// Build a canonical Huffman code from code lengths; returns 0 for a complete
+	// code, > 0 for an incomplete one and < 0 if it is over-subscribed.
+	static int construct(huffman &h, const short *length, int n)
+	{
+		short offs[16];
+		int left = 1;
+
+		memset(h.count, 0, sizeof(h.count));
+
+		for (int sym = 0; sym < n; ++sym) {
+			h.count[length[sym]]++;
+		}
+
+		if (h.count[0] == n) {
+			return 0;
+		}
+
+		for (int len = 1; len < 16; ++len) {
+			left = (left << 1) - h.count[len];
+			if (left < 0) {
+				return left;
+			}
+		}
+
+		offs[1] = 0;
+		for (int len = 1; len < 15; ++len) {
+			offs[len+1] = offs[len] + h.count[len];
+		}
+
+		for (int sym = 0; sym < n; ++sym) {
+			if (length[sym] != 0) {
+				h.symbol[offs[length[sym]]++] = static_cast<short>(sym);
+			}
+		}
+
+		return left;
+	}
+
+	bool codes(const huffman &lencode, const huffman &distcode)
+	{
+		static const short lbase[29] = {
+			3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+			35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+		static const short lext[29] = {
+			0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+			3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+		static const unsigned short dbase[30] = {
+			1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+			257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145,
+			8193, 12289, 16385, 24577 };
+		static const short dext[30] = {
+			0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+			7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+		for (;;) {
+			int sym = decode(lencode);
+
+			if (sym < 0) {
+				return false;
+			}
+
+			if (sym < 256) {
+				put(static_cast<unsigned char>(sym));
+				continue;
+			}
+
+			if (sym == 256) {
+				return true;  // end of block
+			}
+
+			sym -= 257;
+			if (sym >= 29) {
+				return false;
+			}
+
+			size_t len = lbase[sym] + bits(lext[sym]);
+			int dsym = decode(distcode);
+
+			if (dsym < 0 || dsym >= 30) {
+				return false;
+			}
+
+			size_t dist = dbase[dsym] + bits(dext[dsym]);
+
+			if (m_eof || dist > m_outpos) {
+				return false;
+			}
+
+			// byte by byte, the source may overlap the destination
+			for (; len > 0; --len) {
+				put(m_out[(m_outpos - dist) & m_mask]);
+			}
+		}
+	}
+
+	bool fixed()
+	{
+		huffman lencode, distcode;
+		short lengths[288];
+		int sym = 0;
+
+		for (; sym < 144; ++sym) lengths[sym] = 8;
+		for (; sym < 256; ++sym) lengths[sym] = 9;
+		for (; sym < 280; ++sym) lengths[sym] = 7;
+		for (; sym < 288; ++sym) lengths[sym] = 8;
+		construct(lencode, lengths, 288);
+
+		for (sym = 0; sym < 30; ++sym) lengths[sym] = 5;
+		construct(distcode, lengths, 30);
+
+		return codes(lencode, distcode);
+	}
+
+	bool dynamic()
+	{
+		static const short order[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+		huffman lencode, distcode;
+		short lengths[286 + 30];
+
+		int nlen = bits(5) + 257;
+		int ndist = bits(5) + 1;
+		int ncode = bits(4) + 4;
+
+		if (m_eof || nlen > 286 || ndist > 30) {
+			return false;
+		}
+
+		// code length code
+		int index = 0;
+		for (; index < ncode; ++index) lengths[order[index]] = static_cast<short>(bits(3));
+		for (; index < 19; ++index) lengths[order[index]] = 0;
+
+		if (m_eof || construct(lencode, lengths, 19) != 0) {
+			return false;
+		}
+
+		// literal/length and distance code lengths
+		for (index = 0; index < nlen + ndist; ) {
+			int sym = decode(lencode);
+
+			if (sym < 0) {
+				return false;
+			}
+
+			if (sym < 16) {
+				lengths[index++] = static_cast<short>(sym);
+				continue;
+			}
+
+			short len = 0;
+			int n;
+
+			if (sym == 16) {
+				if (index == 0) {
+					return false;
+				}
+				len = lengths[index-1];
+				n = 3 + bits(2);
+			} else if (sym == 17) {
+				n = 3 + bits(3);
+			} else {
+				n = 11 + bits(7);
+			}
+
+			if (m_eof || index + n > nlen + ndist) {
+				return false;
+			}
+
+			while (n-- > 0) {
+				lengths[index++] = len;
+			}
+		}
+
+		if (lengths[256] == 0) {
+			return false;  // no end-of-block code
+		}
+
+		// incomplete codes are only allowed for a single code
+		int err = construct(lencode, lengths, nlen);
+		if (err < 0 || (err > 0 && nlen - lencode.count[0] != 1)) {
+			return false;
+		}
+
+		err = construct(distcode, lengths + nlen, ndist);
+		if (err < 0 || (err > 0 && ndist - distcode.count[0] != 1)) {
+			return false;
+		}
+
+		return codes(lencode, distcode);
+	}
+
+
+public:
+
+	raw_inflater(const unsigned char *in, size_t inlen)
+	: m_in(in), m_inlen(inlen)
+	{}
+
+	raw_inflater(read_fn fn, void *ctx)
+	: m_in(m_inbuf), m_inlen(0), m_read(fn), m_ctx(ctx)
+	{}
+
+	// Decompress all blocks into out; false if the data is corrupt or
+	// truncated. Output beyond outlen is dropped, see size().
+	bool run(unsigned char *out, size_t outlen)
+	{
+		int last;
+
+		m_out = out;
+		m_outlen = outlen;
+
+		do {
+			last = bits(1);
+			int type = bits(2);
+			bool ok;
+
+			switch (type)
+			{
+			case 0:
+				ok = stored();
+				break;
+			case 1:
+				ok = fixed();
+				break;
+			case 2:
+				ok = dynamic();
+				break;
+			default:
+				ok = false;
+				break;
+			}
+
+			if (m_eof || !ok) {
+				return false;
+			}
+		} while (!last);
+
+		return true;
+	}
+
+	// uncompressed size; the output buffer only holds the data if it is <= outlen
+	unsigned long long size() const {
+		return m_outpos;
+	}
+
+	// compressed size, up to and including the byte with the end of the final block
+	unsigned long long consumed() const {
+		return m_inbase + m_inpos;
+	}
+
+	// input the callback delivered past the end of the DEFLATE data
+	void unused(const unsigned char *&p, size_t &len) const {
+		p = m_in + m_inpos;
+		len = m_inlen - m_inpos;
+	}
+};
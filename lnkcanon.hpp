@@ -0,0 +1,250 @@
+/*
+Licensed under the MIT License <http://opensource.org/licenses/MIT>.
+SPDX-License-Identifier: MIT
+Copyright (c) 2020-2026 djcj@gmx.de
+
+Permission is hereby  granted, free of charge, to any  person obtaining a copy
+of this software and associated  documentation files (the "Software"), to deal
+in the Software  without restriction, including without  limitation the rights
+to  use, copy,  modify, merge,  publish, distribute,  sublicense, and/or  sell
+copies  of  the Software,  and  to  permit persons  to  whom  the Software  is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE  IS PROVIDED "AS  IS", WITHOUT WARRANTY  OF ANY KIND,  EXPRESS OR
+IMPLIED,  INCLUDING BUT  NOT  LIMITED TO  THE  WARRANTIES OF  MERCHANTABILITY,
+FITNESS FOR  A PARTICULAR PURPOSE AND  NONINFRINGEMENT. IN NO EVENT  SHALL THE
+AUTHORS  OR COPYRIGHT  HOLDERS  BE  LIABLE FOR  ANY  CLAIM,  DAMAGES OR  OTHER
+LIABILITY, WHETHER IN AN ACTION OF  CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE  OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/**
+ * Turn a Shell Link into a reproducible byte sequence: the same link
+ * settings for the same target path give the same file, no matter when, on
+ * which machine or how often the link was created.
+ *
+ * - header: CreationTime, AccessTime, WriteTime and FileSize of the target are
+ *   zeroed, FileAttributes are reduced to FILE_ATTRIBUTE_DIRECTORY
+ * - LinkTargetIDList: size and timestamps of file entry items as well as the
+ *   timestamps and NTFS file reference of their 0xBEEF0004 extension blocks
+ *   are zeroed
+ * - LinkInfo: DriveSerialNumber of the VolumeID is zeroed and the VolumeLabel
+ *   is cut to an empty string, the offsets behind it are moved accordingly
+ * - ExtraData: the TrackerDataBlock (machine ID and object IDs, which are
+ *   newly generated every time) is dropped, the remaining blocks are sorted
+ *   by signature
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <vector>
+#include "compat.hpp"
+#include "lnkparser.hpp"
+
+
+class shell_link_canonicalizer
+{
+private:
+
+	struct block
+	{
+		size_t offset;
+		size_t size;
+		DWORD sig;
+
+		bool operator<(const block &other) const {
+			return sig < other.sig;
+		}
+	};
+
+	static DWORD u16(const unsigned char *p) {
+		return p[0] | (p[1] << 8);
+	}
+
+	static DWORD u32(const unsigned char *p) {
+		return p[0] | (p[1] << 8) | (p[2] << 16) | (static_cast<DWORD>(p[3]) << 24);
+	}
+
+	static void put32(unsigned char *p, DWORD val) {
+		p[0] = val & 0xFF;
+		p[1] = (val >> 8) & 0xFF;
+		p[2] = (val >> 16) & 0xFF;
+		p[3] = (val >> 24) & 0xFF;
+	}
+
+	static void zero(unsigned char *p, size_t len) {
+		memset(p, 0, len);
+	}
+
+	static void canonicalize_idlist(unsigned char *p, size_t len)
+	{
+		size_t off = 0;
+
+		while (off + 2 <= len) {
+			size_t cb = u16(p + off);
+
+			if (cb < 3 || off + cb > len) {
+				break;
+			}
+
+			unsigned char *item = p + off;
+			BYTE type = item[2];
+
+			if ((type & 0x70) == 0x30 && cb >= 16) {
+				// file entry: file size and modification time
+				zero(item + 4, 8);
+
+				size_t ext = u16(item + cb - 2);
+
+				if (ext >= 14 && ext + 20 <= cb && u32(item + ext + 4) == 0xBEEF0004 &&
+					ext + u16(item + ext) <= cb)
+				{
+					DWORD version = u16(item + ext + 2);
+
+					// creation and access time
+					zero(item + ext + 8, 8);
+
+					// NTFS file reference
+					if (version >= 7 && ext + 28 <= cb) {
+						zero(item + ext + 20, 8);
+					}
+				}
+			}
+
+			off += cb;
+		}
+	}
+
+	// li is the offset of LinkInfo in out, which the parser has checked to be
+	// at least 28 bytes and within the link
+	static void canonicalize_linkinfo(std::vector<unsigned char> &out, size_t li)
+	{
+		unsigned char *p = &out[li];
+		size_t len = u32(p);
+		size_t hdrsize = u32(p + 4);
+
+		if ((u32(p + 8) & 0x1) == 0 || hdrsize > len) {
+			return;  // no VolumeID
+		}
+
+		size_t vol = u32(p + 12);
+
+		if (vol < hdrsize || vol > len || len - vol < 16 || u32(p + vol) < 16 || u32(p + vol) > len - vol) {
+			return;
+		}
+
+		unsigned char *v = p + vol;
+		size_t vsize = u32(v);
+		bool unicode = (u32(v + 12) == 0x14);
+		size_t labeloff = unicode ? 0x14 : 0x10;
+		size_t labellen = unicode ? 2 : 1;   // empty string
+
+		// DriveSerialNumber
+		zero(v + 8, 4);
+
+		if (vsize < labeloff + labellen) {
+			return;
+		}
+
+		// LocalBasePath, CommonNetworkRelativeLink and CommonPathSuffix offsets,
+		// plus their Unicode variants if the header has them
+		size_t nfields = (hdrsize >= 0x24) ? 5 : 3;
+		size_t delta = vsize - labeloff - labellen;
+
+		for (size_t i = 0; i < nfields; ++i) {
+			DWORD off = u32(p + 16 + 4*i);
+
+			if (off >= vol && off < vol + vsize) {
+				return;  // something else lives inside the VolumeID, keep its size
+			}
+		}
+
+		for (size_t i = 0; i < nfields; ++i) {
+			DWORD off = u32(p + 16 + 4*i);
+
+			if (off >= vol + vsize) {
+				put32(p + 16 + 4*i, static_cast<DWORD>(off - delta));
+			}
+		}
+
+		zero(v + labeloff, vsize - labeloff);
+
+		put32(p, static_cast<DWORD>(len - delta));
+		put32(v, static_cast<DWORD>(vsize - delta));
+		put32(v + (unicode ? 16 : 12), static_cast<DWORD>(labeloff));
+
+		out.erase(out.begin() + li + vol + labeloff + labellen, out.begin() + li + vol + vsize);
+	}
+
+
+public:
+
+	// Write the canonical form of the Shell Link in data to out.
+	bool canonicalize(const unsigned char *data, size_t size, std::vector<unsigned char> &out)
+	{
+		shell_link_parser *parser = new shell_link_parser;
+		std::vector<block> blocks;
+
+		if (!parser->load(data, size)) {
+			delete parser;
+			return false;
+		}
+
+		size_t idlist = parser->idlist_offset();
+		size_t linkinfo = parser->linkinfo_offset();
+		size_t extradata = parser->extradata_offset();
+		size_t linksize = parser->size();
+
+		delete parser;
+
+		out.assign(data, data + extradata);
+
+		// header
+		DWORD attr = u32(&out[LNK_OFFSET_ATTRIBUTES]) & 0x10;  // FILE_ATTRIBUTE_DIRECTORY
+		zero(&out[LNK_OFFSET_ATTRIBUTES], LNK_OFFSET_ICONINDEX - LNK_OFFSET_ATTRIBUTES);
+		out[LNK_OFFSET_ATTRIBUTES] = static_cast<unsigned char>(attr);
+
+		if (idlist != 0) {
+			canonicalize_idlist(&out[idlist + 2], u16(&out[idlist]));
+		}
+
+		// LinkInfo comes last, it may change the size of the output
+		if (linkinfo != 0) {
+			canonicalize_linkinfo(out, linkinfo);
+		}
+
+		// ExtraData blocks
+		for (size_t pos = extradata; pos + 8 <= linksize; ) {
+			block b;
+			b.offset = pos;
+			b.size = u32(data + pos);
+			b.sig = u32(data + pos + 4);
+
+			if (b.size < 8) {
+				break;
+			}
+
+			if (b.sig != LNK_BLOCK_TRACKER) {
+				blocks.push_back(b);
+			}
+
+			pos += b.size;
+		}
+
+		std::stable_sort(blocks.begin(), blocks.end());
+
+		for (size_t i = 0; i < blocks.size(); ++i) {
+			out.insert(out.end(), data + blocks[i].offset, data + blocks[i].offset + blocks[i].size);
+		}
+
+		// TerminalBlock
+		out.insert(out.end(), 4, 0);
+
+		return true;
+	}
+};
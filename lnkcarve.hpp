@@ -0,0 +1,325 @@
+/*
+Licensed under the MIT License <http://opensource.org/licenses/MIT>.
+SPDX-License-Identifier: MIT
+Copyright (c) 2020-2026 djcj@gmx.de
+
+Permission is hereby  granted, free of charge, to any  person obtaining a copy
+of this software and associated  documentation files (the "Software"), to deal
+in the Software  without restriction, including without  limitation the rights
+to  use, copy,  modify, merge,  publish, distribute,  sublicense, and/or  sell
+copies  of  the Software,  and  to  permit persons  to  whom  the Software  is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE  IS PROVIDED "AS  IS", WITHOUT WARRANTY  OF ANY KIND,  EXPRESS OR
+IMPLIED,  INCLUDING BUT  NOT  LIMITED TO  THE  WARRANTIES OF  MERCHANTABILITY,
+FITNESS FOR  A PARTICULAR PURPOSE AND  NONINFRINGEMENT. IN NO EVENT  SHALL THE
+AUTHORS  OR COPYRIGHT  HOLDERS  BE  LIABLE FOR  ANY  CLAIM,  DAMAGES OR  OTHER
+LIABILITY, WHETHER IN AN ACTION OF  CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE  OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/**
+ * Carve Shell Links out of raw data such as disk images or memory dumps.
+ *
+ * The image is memory mapped and split into chunks that are scanned in
+ * parallel for the ShellLinkHeader signature (HeaderSize 0x4C followed by the
+ * Shell Link CLSID). Candidates must start inside a chunk, but the signature
+ * and the link itself may reach into the following chunk(s), so links on
+ * chunk boundaries are found exactly once. Every candidate is validated by
+ * walking its section sizes with shell_link_parser.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <vector>
+#include "compat.hpp"
+#include "compat_thread.hpp"
+#include "lnkparser.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+# include <emmintrin.h>
+# define LNK_CARVE_SSE2
+#endif
+#ifdef _MSC_VER
+# include <intrin.h>
+#endif
+
+
+struct carved_link
+{
+	unsigned long long offset;
+	size_t size;
+
+	bool operator<(const carved_link &other) const {
+		return offset < other.offset;
+	}
+};
+
+
+class lnk_carver
+{
+private:
+
+	compat_mapped_file m_file;
+	const unsigned char *m_data = NULL;
+	unsigned long long m_size = 0;
+	unsigned long long m_chunksize;       // bytes scanned per work item
+	size_t m_maxlink;                     // candidates may not be larger than this
+	std::atomic<unsigned long long> m_nextchunk;
+	compat_mutex m_lock;
+	std::vector<carved_link> m_found;
+
+
+	static unsigned lowest_bit(unsigned mask)
+	{
+#ifdef _MSC_VER
+		unsigned long idx;
+		_BitScanForward(&idx, mask);
+		return idx;
+#else
+		return __builtin_ctz(mask);
+#endif
+	}
+
+	// returns the size of a valid Shell Link at pos, or 0
+	size_t check(unsigned long long pos, shell_link_parser &parser)
+	{
+		unsigned long long avail = m_size - pos;
+
+		if (avail > m_maxlink) {
+			avail = m_maxlink;
+		}
+
+		if (memcmp(m_data + pos, lnk_signature, sizeof(lnk_signature)) != 0 ||
+			!parser.load(m_data + pos, static_cast<size_t>(avail)))
+		{
+			return 0;
+		}
+
+		return parser.size();
+	}
+
+	void scan(unsigned long long begin, unsigned long long end,
+				shell_link_parser &parser, std::vector<carved_link> &found)
+	{
+		const unsigned char *p = m_data;
+		unsigned long long i = begin;
+		size_t n;
+
+		// no link can start in the last bytes of the image
+		if (end > m_size - LNK_HEADER_SIZE + 1) {
+			end = m_size - LNK_HEADER_SIZE + 1;
+		}
+
+#ifdef LNK_CARVE_SSE2
+		// compare 4 of the signature bytes for 16 positions at once:
+		// 0x4C at +0, 0x00 at +1, 0x01 at +4 and 0x14 at +5
+		const __m128i b0 = _mm_set1_epi8(0x4C);
+		const __m128i b1 = _mm_setzero_si128();
+		const __m128i b4 = _mm_set1_epi8(0x01);
+		const __m128i b5 = _mm_set1_epi8(0x14);
+
+		while (i + 16 <= end) {
+			const __m128i *q = reinterpret_cast<const __m128i *>(p + i);
+			__m128i m0 = _mm_cmpeq_epi8(_mm_loadu_si128(q), b0);
+			__m128i m1 = _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(p + i + 1)), b1);
+			__m128i m4 = _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(p + i + 4)), b4);
+			__m128i m5 = _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(p + i + 5)), b5);
+			unsigned mask = _mm_movemask_epi8(_mm_and_si128(_mm_and_si128(m0, m1), _mm_and_si128(m4, m5)));
+			unsigned long long next = i + 16;
+
+			while (mask != 0) {
+				unsigned long long pos = i + lowest_bit(mask);
+				mask &= mask - 1;
+
+				if ((n = check(pos, parser)) != 0) {
+					carved_link cl = { pos, n };
+					found.push_back(cl);
+
+					// don't look for links inside of this one
+					next = pos + n;
+					break;
+				}
+			}
+
+			i = next;
+		}
+#endif
+
+		while (i < end) {
+			const void *hit = memchr(p + i, 0x4C, static_cast<size_t>(end - i));
+
+			if (!hit) {
+				break;
+			}
+
+			i = static_cast<const unsigned char *>(hit) - p;
+
+			if ((n = check(i, parser)) != 0) {
+				carved_link cl = { i, n };
+				found.push_back(cl);
+				i += n;
+			} else {
+				++i;
+			}
+		}
+	}
+
+	// Sort the hits of all chunks and drop those inside of an earlier link.
+	// A chunk's scan jumps over every link it finds; if that link is dropped
+	// (it started inside a link of the previous chunk), the part of it that
+	// sticks out of the kept link was never looked at and is scanned again,
+	// starting where a scan of the whole image would be.
+	void resolve_overlaps()
+	{
+		shell_link_parser *parser = NULL;
+		std::vector<carved_link> extra;
+		unsigned long long cursor = 0;      // end of the last kept link
+		unsigned long long empty_from = 0;  // no link starts in [empty_from, empty_to)
+		unsigned long long empty_to = 0;
+		size_t keep = 0;
+
+		std::sort(m_found.begin(), m_found.end());
+
+		for (size_t i = 0; i < m_found.size(); ++i) {
+			carved_link cl = m_found[i];
+			unsigned long long end = cl.offset + cl.size;
+
+			if (cl.offset >= cursor) {
+				m_found[keep++] = cl;
+				cursor = end;
+				continue;
+			}
+
+			if (end <= cursor) {
+				continue;
+			}
+
+			unsigned long long from = (empty_from <= cursor && empty_to > cursor) ? empty_to : cursor;
+
+			if (from >= end) {
+				continue;
+			}
+
+			if (!parser) {
+				parser = new shell_link_parser;
+			}
+
+			extra.clear();
+			scan(from, end, *parser, extra);
+
+			if (extra.empty()) {
+				empty_from = cursor;
+				empty_to = end;
+				continue;
+			}
+
+			// hits of other chunks may be found again, keep them once
+			m_found.insert(m_found.begin() + i + 1, extra.begin(), extra.end());
+			std::sort(m_found.begin() + i + 1, m_found.end());
+			m_found.erase(std::unique(m_found.begin() + i + 1, m_found.end(), same_offset), m_found.end());
+		}
+
+		delete parser;
+
+		m_found.resize(keep);
+	}
+
+	static bool same_offset(const carved_link &a, const carved_link &b) {
+		return a.offset == b.offset;
+	}
+
+	static void worker(void *arg)
+	{
+		lnk_carver *self = static_cast<lnk_carver *>(arg);
+		shell_link_parser *parser = new shell_link_parser;
+		std::vector<carved_link> found;
+		unsigned long long chunk;
+
+		while ((chunk = self->m_nextchunk++) < (self->m_size + self->m_chunksize - 1) / self->m_chunksize) {
+			unsigned long long begin = chunk * self->m_chunksize;
+			unsigned long long end = begin + self->m_chunksize;
+
+			self->scan(begin, (end > self->m_size) ? self->m_size : end, *parser, found);
+		}
+
+		delete parser;
+
+		self->m_lock.lock();
+		self->m_found.insert(self->m_found.end(), found.begin(), found.end());
+		self->m_lock.unlock();
+	}
+
+
+public:
+
+	lnk_carver(unsigned long long chunksize = 16*1024*1024, size_t maxlink = 1024*1024)
+	: m_chunksize(chunksize),
+	  m_maxlink(maxlink),
+	  m_nextchunk(0)
+	{}
+
+	bool open(const wchar_t *path)
+	{
+		m_found.clear();
+
+		if (!m_file.open(path)) {
+			return false;
+		}
+
+		m_data = m_file.data();
+		m_size = m_file.size();
+		m_file.advise_sequential();
+
+		return true;
+	}
+
+	// Scan the whole image with nthreads threads (0 = one per processor).
+	// Results are sorted by offset and don't depend on the chunk size; links
+	// that lie inside of another link found in a neighbouring chunk are dropped.
+	void run(unsigned nthreads = 0)
+	{
+		m_found.clear();
+		m_nextchunk = 0;
+
+		if (m_size < LNK_HEADER_SIZE) {
+			return;
+		}
+
+		if (nthreads == 0) {
+			nthreads = compat_cpu_count();
+		}
+
+		compat_thread *threads = new compat_thread[nthreads];
+		unsigned started = 0;
+
+		for (unsigned i = 0; i < nthreads; ++i) {
+			if (threads[i].start(worker, this)) {
+				++started;
+			}
+		}
+
+		if (started == 0) {
+			worker(this);
+		}
+
+		delete[] threads;
+
+		resolve_overlaps();
+	}
+
+	const std::vector<carved_link> &results() const {
+		return m_found;
+	}
+
+	// data of a carved link, valid as long as the carver exists
+	const unsigned char *data(const carved_link &cl) const {
+		return m_data + cl.offset;
+	}
+};
@@ -0,0 +1,444 @@
+/*
+Licensed under the MIT License <http://opensource.org/licenses/MIT>.
+SPDX-License-Identifier: MIT
+Copyright (c) 2020-2026 djcj@gmx.de
+
+Permission is hereby  granted, free of charge, to any  person obtaining a copy
+of this software and associated  documentation files (the "Software"), to deal
+in the Software  without restriction, including without  limitation the rights
+to  use, copy,  modify, merge,  publish, distribute,  sublicense, and/or  sell
+copies  of  the Software,  and  to  permit persons  to  whom  the Software  is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE  IS PROVIDED "AS  IS", WITHOUT WARRANTY  OF ANY KIND,  EXPRESS OR
+IMPLIED,  INCLUDING BUT  NOT  LIMITED TO  THE  WARRANTIES OF  MERCHANTABILITY,
+FITNESS FOR  A PARTICULAR PURPOSE AND  NONINFRINGEMENT. IN NO EVENT  SHALL THE
+AUTHORS  OR COPYRIGHT  HOLDERS  BE  LIABLE FOR  ANY  CLAIM,  DAMAGES OR  OTHER
+LIABILITY, WHETHER IN AN ACTION OF  CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE  OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/**
+ * Convert Shell Links into freedesktop.org desktop entries that start the
+ * target with Wine.
+ *
+ * Target, arguments, working directory, icon and description are mapped to
+ * the Exec, Path, Icon and Comment keys; Windows paths are translated with a
+ * drive_map (the target is kept as Windows path if there is no mapping for
+ * it, Wine can resolve those itself). The icon index has no equivalent and is
+ * kept in X-Windows-IconIndex.
+ *
+ * Conversion runs as a pipeline of reader, converter and writer threads
+ * connected by bounded queues, so large sets of links are converted at the
+ * speed of the disk while memory use stays constant. The links are read in
+ * on-disk order by a read_scheduler.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "bounded_queue.hpp"
+#include "compat.hpp"
+#include "compat_thread.hpp"
+#include "drivemap.hpp"
+#include "lnkparser.hpp"
+#include "readsched.hpp"
+
+
+class desktop_converter
+{
+public:
+
+	// per file status after run()
+	enum {
+		CONVERT_OK = 0,
+		CONVERT_READ_ERROR,
+		CONVERT_PARSE_ERROR,
+		CONVERT_NO_TARGET,
+		CONVERT_WRITE_ERROR
+	};
+
+
+private:
+
+	struct job
+	{
+		size_t index;
+		std::vector<unsigned char> data;
+		std::string entry;
+	};
+
+	const drive_map &m_drives;
+	std::wstring m_outdir;
+	std::string m_launcher;
+	unsigned m_io_threads;
+
+	const std::vector<std::wstring> *m_files = NULL;
+	std::vector<std::wstring> m_names;      // output file names without extension
+	std::vector<int> m_status;
+
+	bounded_queue<job *> m_toconvert;
+	bounded_queue<job *> m_towrite;
+	std::atomic<unsigned> m_converters;
+
+
+	static std::string utf8(const wchar_t *s)
+	{
+		std::string out;
+		char buf[4*1024];
+
+		// long strings are converted in pieces
+		while (*s != 0) {
+			wchar_t tmp[1024];
+			size_t n = 0;
+
+			while (s[n] != 0 && n + 1 < _countof(tmp)) {
+				tmp[n] = s[n];
+				++n;
+			}
+
+			// don't split surrogate pairs
+			if (sizeof(wchar_t) == 2 && s[n] != 0 && tmp[n-1] >= 0xD800 && tmp[n-1] <= 0xDBFF) {
+				--n;
+			}
+
+			tmp[n] = 0;
+			compat_wide_to_utf8(tmp, buf, sizeof(buf));
+			out += buf;
+			s += n;
+		}
+
+		return out;
+	}
+
+	// escape rules for values of type string
+	static std::string escape(const std::string &s)
+	{
+		std::string out;
+
+		for (size_t i = 0; i < s.size(); ++i) {
+			switch (s[i])
+			{
+			case '\\': out += "\\\\"; break;
+			case '\n': out += "\\n"; break;
+			case '\r': out += "\\r"; break;
+			case '\t': out += "\\t"; break;
+			default: out += s[i]; break;
+			}
+		}
+
+		return out;
+	}
+
+	// quote one argument of the Exec key
+	static std::string exec_quote(const std::string &s)
+	{
+		std::string out = "\"";
+
+		for (size_t i = 0; i < s.size(); ++i) {
+			if (s[i] == '"' || s[i] == '`' || s[i] == '$' || s[i] == '\\') {
+				out += '\\';
+			} else if (s[i] == '%') {
+				out += '%';
+			}
+			out += s[i];
+		}
+
+		return out + "\"";
+	}
+
+	// split a Windows command line the way CommandLineToArgvW() does
+	static void split_args(const wchar_t *p, std::vector<std::wstring> &out)
+	{
+		for (;;) {
+			std::wstring arg;
+			bool quoted = false;
+
+			while (*p == L' ' || *p == L'\t') ++p;
+
+			if (*p == 0) {
+				break;
+			}
+
+			while (*p != 0 && (quoted || (*p != L' ' && *p != L'\t'))) {
+				size_t bs = 0;
+
+				while (*p == L'\\') {
+					++bs;
+					++p;
+				}
+
+				if (*p == L'"') {
+					arg.append(bs / 2, L'\\');
+
+					if (bs % 2 == 1) {
+						arg += L'"';
+					} else if (quoted && p[1] == L'"') {
+						arg += L'"';
+						++p;
+					} else {
+						quoted = !quoted;
+					}
+					++p;
+				} else {
+					arg.append(bs, L'\\');
+					if (*p != 0 && (quoted || (*p != L' ' && *p != L'\t'))) {
+						arg += *p++;
+					}
+				}
+			}
+
+			out.push_back(arg);
+		}
+	}
+
+	std::string local_path(const wchar_t *path, bool keep_unmapped) const
+	{
+		std::wstring local;
+
+		if (m_drives.translate(path, local)) {
+			return utf8(local.c_str());
+		}
+
+		return keep_unmapped ? utf8(path) : std::string();
+	}
+
+	int convert(job &j, shell_link_parser &shl) const
+	{
+		const wchar_t *p;
+		int n = 0;
+
+		if (!shl.load(j.data.empty() ? NULL : &j.data[0], j.data.size())) {
+			return CONVERT_PARSE_ERROR;
+		}
+
+		if ((p = shl.get_path()) == NULL) {
+			return CONVERT_NO_TARGET;
+		}
+
+		std::string &e = j.entry;
+
+		e = "[Desktop Entry]\nType=Application\n";
+		e += "Name=" + escape(utf8(base_name((*m_files)[j.index]).c_str())) + "\n";
+
+		std::string exec = m_launcher + " " + exec_quote(local_path(p, true));
+
+		if ((p = shl.get_arguments()) != NULL) {
+			std::vector<std::wstring> args;
+			split_args(p, args);
+
+			for (size_t i = 0; i < args.size(); ++i) {
+				exec += " " + exec_quote(utf8(args[i].c_str()));
+			}
+		}
+
+		e += "Exec=" + escape(exec) + "\n";
+
+		if ((p = shl.get_workingdir()) != NULL) {
+			std::string dir = local_path(p, false);
+			if (!dir.empty()) e += "Path=" + escape(dir) + "\n";
+		}
+
+		if ((p = shl.get_iconlocation(n)) != NULL) {
+			std::string icon = local_path(p, false);
+			if (!icon.empty()) {
+				char idx[32];
+				snprintf(idx, sizeof(idx), "%d", n);
+				e += "Icon=" + escape(icon) + "\n";
+				e += std::string("X-Windows-IconIndex=") + idx + "\n";
+			}
+		}
+
+		if ((p = shl.get_description()) != NULL) {
+			e += "Comment=" + escape(utf8(p)) + "\n";
+		}
+
+		e += "Terminal=false\n";
+
+		return CONVERT_OK;
+	}
+
+	// called by the read_scheduler threads
+	void read_done(size_t i, const unsigned char *data, size_t size)
+	{
+		if (!data) {
+			m_status[i] = CONVERT_READ_ERROR;
+			return;
+		}
+
+		job *j = new job;
+		j->index = i;
+		j->data.assign(data, data + size);
+
+		if (!m_toconvert.push(j)) {
+			delete j;
+		}
+	}
+
+	static void converter(void *arg)
+	{
+		desktop_converter *self = static_cast<desktop_converter *>(arg);
+		shell_link_parser *shl = new shell_link_parser;
+		job *j;
+
+		while (self->m_toconvert.pop(j)) {
+			int rv = self->convert(*j, *shl);
+
+			// the input isn't needed anymore
+			std::vector<unsigned char>().swap(j->data);
+
+			if (rv != CONVERT_OK) {
+				self->m_status[j->index] = rv;
+				delete j;
+			} else if (!self->m_towrite.push(j)) {
+				delete j;
+			}
+		}
+
+		delete shl;
+
+		if (--self->m_converters == 0) {
+			self->m_towrite.close();
+		}
+	}
+
+	static void writer(void *arg)
+	{
+		desktop_converter *self = static_cast<desktop_converter *>(arg);
+		job *j;
+
+		while (self->m_towrite.pop(j)) {
+#ifdef _WIN32
+			std::wstring path = self->m_outdir + L"\\" + self->m_names[j->index] + L".desktop";
+#else
+			std::wstring path = self->m_outdir + L"/" + self->m_names[j->index] + L".desktop";
+#endif
+			FILE *fp = compat_wfopen(path.c_str(), L"wb");
+			bool ok = false;
+
+			if (fp) {
+				ok = (fwrite(j->entry.data(), 1, j->entry.size(), fp) == j->entry.size());
+				ok = (fclose(fp) == 0) && ok;
+			}
+
+			self->m_status[j->index] = ok ? CONVERT_OK : CONVERT_WRITE_ERROR;
+			delete j;
+		}
+	}
+
+	// file name without directory and .lnk extension
+	static std::wstring base_name(const std::wstring &path)
+	{
+		size_t slash = path.find_last_of(L"\\/");
+		std::wstring name = path.substr((slash == std::wstring::npos) ? 0 : slash + 1);
+
+		if (is_lnk_filename(name.c_str())) {
+			name.erase(name.size() - 4);
+		}
+
+		return name;
+	}
+
+	// unique output names in input order: "name", "name-2", "name-3" ...
+	void make_names()
+	{
+		std::unordered_map<std::wstring, unsigned> seen;  // last suffix per base name
+		std::unordered_set<std::wstring> used;            // all names handed out
+
+		m_names.clear();
+
+		for (size_t i = 0; i < m_files->size(); ++i) {
+			std::wstring name = base_name((*m_files)[i]);
+			std::wstring key = name;
+			for (size_t k = 0; k < key.size(); ++k) {
+				key[k] = towlower(key[k]);
+			}
+
+			// a suffixed name may also exist as a real one ("x-2.lnk")
+			unsigned &n = seen[key];
+			std::wstring suffix;
+
+			while (!used.insert(key + suffix).second) {
+				n = (n < 2) ? 2 : n + 1;
+				suffix = L"-" + std::to_wstring(n);
+			}
+
+			m_names.push_back(name + suffix);
+		}
+	}
+
+
+public:
+
+	desktop_converter(const drive_map &drives, const wchar_t *outdir,
+						const char *launcher = "wine", unsigned io_threads = 4)
+	: m_drives(drives),
+	  m_outdir(outdir),
+	  m_launcher(launcher),
+	  m_io_threads(io_threads ? io_threads : 1),
+	  m_toconvert(256),
+	  m_towrite(256),
+	  m_converters(0)
+	{}
+
+	// Convert all files; status[i] is one of the CONVERT_* values for files[i].
+	// Returns false if the worker threads couldn't be started.
+	bool run(const std::vector<std::wstring> &files, std::vector<int> &status)
+	{
+		unsigned nconv = compat_cpu_count();
+		compat_thread *converters = new compat_thread[nconv];
+		compat_thread *writers = new compat_thread[m_io_threads];
+		unsigned nwriters = 0;
+
+		m_files = &files;
+		m_status.assign(files.size(), CONVERT_OK);
+		m_converters = 0;
+		make_names();
+
+		// Start the stages back to front; no stage can finish before the
+		// one feeding it has closed its queue, so the counter can be
+		// raised while threads are already running.
+		for (unsigned i = 0; i < m_io_threads; ++i) {
+			if (writers[i].start(writer, this)) ++nwriters;
+		}
+
+		for (unsigned i = 0; i < nconv; ++i) {
+			++m_converters;
+			if (!converters[i].start(converter, this)) --m_converters;
+		}
+
+		bool ok = (nwriters > 0 && m_converters > 0);
+
+		// the read stage runs until all files were read
+		if (ok) {
+			read_scheduler sched(m_io_threads, 128, 1024*1024);
+
+			sched.run(files, [this](unsigned, size_t i, const unsigned char *data, size_t size) {
+				read_done(i, data, size);
+			});
+		}
+
+		m_toconvert.close();
+		if (m_converters == 0) m_towrite.close();
+
+		delete[] converters;
+		delete[] writers;
+
+		status.swap(m_status);
+
+		return ok;
+	}
+
+	// output file name (without directory and extension) of files[i]
+	const std::wstring &name(size_t i) const {
+		return m_names[i];
+	}
+};
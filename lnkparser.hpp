@@ -0,0 +1,584 @@
+/*
+Licensed under the MIT License <http://opensource.org/licenses/MIT>.
+SPDX-License-Identifier: MIT
+Copyright (c) 2020-2026 djcj@gmx.de
+
+Permission is hereby  granted, free of charge, to any  person obtaining a copy
+of this software and associated  documentation files (the "Software"), to deal
+in the Software  without restriction, including without  limitation the rights
+to  use, copy,  modify, merge,  publish, distribute,  sublicense, and/or  sell
+copies  of  the Software,  and  to  permit persons  to  whom  the Software  is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE  IS PROVIDED "AS  IS", WITHOUT WARRANTY  OF ANY KIND,  EXPRESS OR
+IMPLIED,  INCLUDING BUT  NOT  LIMITED TO  THE  WARRANTIES OF  MERCHANTABILITY,
+FITNESS FOR  A PARTICULAR PURPOSE AND  NONINFRINGEMENT. IN NO EVENT  SHALL THE
+AUTHORS  OR COPYRIGHT  HOLDERS  BE  LIABLE FOR  ANY  CLAIM,  DAMAGES OR  OTHER
+LIABILITY, WHETHER IN AN ACTION OF  CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE  OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/**
+ * Native Shell Link parser that works on a memory buffer instead of going
+ * through IPersistFile::Load(), so it can be used on data that isn't a file
+ * on disk (archive members, stdin, disk images) and on systems without COM.
+ *
+ * The getters mirror shell_link_info; see the Shell Link specs for the format:
+ * https://learn.microsoft.com/en-us/openspecs/windows_protocols/ms-shllink
+ *
+ * Strings stored in the legacy codepage (no IsUnicode flag) are decoded as
+ * Latin-1 since the codepage of the creating system is unknown.
+ */
+
+#pragma once
+
+#include "compat.hpp"
+
+
+// ShellLinkHeader
+#define LNK_HEADER_SIZE          0x4C
+#define LNK_OFFSET_CLSID         0x04
+#define LNK_OFFSET_FLAGS         0x14
+#define LNK_OFFSET_ATTRIBUTES    0x18
+#define LNK_OFFSET_CTIME         0x1C
+#define LNK_OFFSET_ATIME         0x24
+#define LNK_OFFSET_WTIME         0x2C
+#define LNK_OFFSET_FILESIZE      0x34
+#define LNK_OFFSET_ICONINDEX     0x38
+#define LNK_OFFSET_SHOWCMD       0x3C
+#define LNK_OFFSET_HOTKEY        0x40
+
+// LinkFlags
+#define LNK_HAS_IDLIST           0x00000001
+#define LNK_HAS_LINKINFO         0x00000002
+#define LNK_HAS_NAME             0x00000004
+#define LNK_HAS_RELATIVE_PATH    0x00000008
+#define LNK_HAS_WORKING_DIR      0x00000010
+#define LNK_HAS_ARGUMENTS        0x00000020
+#define LNK_HAS_ICON_LOCATION    0x00000040
+#define LNK_IS_UNICODE           0x00000080
+#define LNK_HAS_EXP_ICON         0x00004000
+
+// ExtraData block signatures
+#define LNK_BLOCK_ENVIRONMENT    0xA0000001
+#define LNK_BLOCK_TRACKER        0xA0000003
+#define LNK_BLOCK_ICON_ENV       0xA0000007
+
+// LinkCLSID 00021401-0000-0000-C000-000000000046, preceded by HeaderSize
+static const unsigned char lnk_signature[20] = {
+	0x4C, 0x00, 0x00, 0x00,
+	0x01, 0x14, 0x02, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0xC0, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x46
+};
+
+
+class shell_link_parser
+{
+private:
+
+	// StringData entries in the order they are stored
+	enum {
+		STR_NAME = 0,
+		STR_RELATIVE_PATH,
+		STR_WORKING_DIR,
+		STR_ARGUMENTS,
+		STR_ICON_LOCATION,
+		STR_COUNT
+	};
+
+	const unsigned char *m_data = NULL;  // Shell Link data (not owned)
+	size_t m_size = 0;                   // Bytes available at m_data
+	size_t m_linksize = 0;               // Bytes used by the Shell Link
+	DWORD m_flags = 0;                   // LinkFlags
+	size_t m_idlist = 0;                 // Offset of the IDList, 0 if not present
+	size_t m_linkinfo = 0;               // Offset of LinkInfo, 0 if not present
+	size_t m_extradata = 0;              // Offset of ExtraData
+	size_t m_str[STR_COUNT] = {0};       // Offsets of StringData entries, 0 if not present
+	size_t m_envblock = 0;               // Offset of EnvironmentVariableDataBlock
+	size_t m_iconblock = 0;              // Offset of IconEnvironmentDataBlock
+
+	unsigned char *m_filebuf = NULL;     // Buffer for load_file(), reused between calls
+	size_t m_filebufsize = 0;
+
+	wchar_t m_buf[32*1024] = {0};
+
+
+	DWORD u16(size_t off) const {
+		return m_data[off] | (m_data[off + 1] << 8);
+	}
+
+	DWORD u32(size_t off) const {
+		return static_cast<DWORD>(m_data[off]) |
+			(static_cast<DWORD>(m_data[off + 1]) << 8) |
+			(static_cast<DWORD>(m_data[off + 2]) << 16) |
+			(static_cast<DWORD>(m_data[off + 3]) << 24);
+	}
+
+	// append a NUL-terminated string found at offset off (but not beyond end) to m_buf
+	size_t append(size_t n, size_t off, size_t end, bool unicode)
+	{
+		if (unicode) {
+			size_t nchars = (end > off) ? (end - off) / 2 : 0;
+			return n + compat_utf16le_to_wide(m_data + off, nchars, m_buf + n, _countof(m_buf) - n);
+		}
+
+		for ( ; off < end && m_data[off] != 0 && n + 1 < _countof(m_buf); ++off) {
+			m_buf[n++] = m_data[off];
+		}
+		m_buf[n] = 0;
+
+		return n;
+	}
+
+	size_t append_sep(size_t n)
+	{
+		if (n > 0 && m_buf[n-1] != L'\\' && n + 1 < _countof(m_buf)) {
+			m_buf[n++] = L'\\';
+			m_buf[n] = 0;
+		}
+		return n;
+	}
+
+	const wchar_t *get_string(int idx)
+	{
+		size_t off = m_str[idx];
+
+		if (off == 0) {
+			return NULL;
+		}
+
+		DWORD count = u16(off);
+		size_t n = append(0, off + 2, off + 2 + count * ((m_flags & LNK_IS_UNICODE) ? 2 : 1),
+							(m_flags & LNK_IS_UNICODE) != 0);
+
+		return (n > 0) ? m_buf : NULL;
+	}
+
+	// TargetUnicode (or TargetAnsi) of an Environment/IconEnvironment data block
+	const wchar_t *get_env_target(size_t off)
+	{
+		if (off == 0) {
+			return NULL;
+		}
+
+		size_t n = append(0, off + 8 + 260, off + 8 + 260 + 520, true);
+
+		if (n == 0) {
+			n = append(0, off + 8, off + 8 + 260, false);
+		}
+
+		return (n > 0) ? m_buf : NULL;
+	}
+
+	// path from LinkInfo: LocalBasePath or NetName, followed by CommonPathSuffix
+	const wchar_t *get_linkinfo_path()
+	{
+		size_t li = m_linkinfo;
+
+		if (li == 0) {
+			return NULL;
+		}
+
+		size_t end = li + u32(li);
+		DWORD hdrsize = u32(li + 4);
+		DWORD liflags = u32(li + 8);
+		DWORD base = u32(li + 16);
+		DWORD cnrl = u32(li + 20);
+		DWORD suffix = u32(li + 24);
+		// the Unicode offsets only exist if the header says so and fits
+		bool unicode = (hdrsize >= 0x24 && hdrsize <= end - li);
+		DWORD base_u = unicode ? u32(li + 28) : 0;
+		DWORD suffix_u = unicode ? u32(li + 32) : 0;
+		size_t n = 0;
+
+		if ((liflags & 0x1) != 0) {
+			// VolumeIDAndLocalBasePath
+			if (base_u != 0 && base_u < end - li) {
+				n = append(0, li + base_u, end, true);
+			} else if (base != 0 && base < end - li) {
+				n = append(0, li + base, end, false);
+			}
+		} else if ((liflags & 0x2) != 0 && cnrl != 0 && cnrl <= end - li && end - li - cnrl >= 20) {
+			// CommonNetworkRelativeLinkAndPathSuffix; offsets are bounded by
+			// subtraction, adding them to a constant can wrap around
+			size_t c = li + cnrl;
+			DWORD netname = u32(c + 8);
+
+			if (u32(c) > end - c) {
+				return NULL;
+			}
+
+			size_t cend = c + u32(c);
+
+			if (netname > 0x14 && c + 28 <= cend && u32(c + 20) != 0 && u32(c + 20) < cend - c) {
+				n = append(0, c + u32(c + 20), cend, true);
+			} else if (netname != 0 && netname < cend - c) {
+				n = append(0, c + netname, cend, false);
+			}
+		}
+
+		if (n == 0) {
+			return NULL;
+		}
+
+		size_t before = n;
+
+		n = append_sep(n);
+
+		if (suffix_u != 0 && suffix_u < end - li) {
+			n = append(n, li + suffix_u, end, true);
+		} else if (suffix != 0 && suffix < end - li) {
+			n = append(n, li + suffix, end, false);
+		}
+
+		if (n == before + 1) {
+			// empty suffix
+			m_buf[before] = 0;
+		}
+
+		return m_buf;
+	}
+
+	// path built from a LinkTargetIDList that consists of My Computer, a volume and file entries
+	const wchar_t *get_idlist_path()
+	{
+		if (m_idlist == 0) {
+			return NULL;
+		}
+
+		size_t off = m_idlist + 2;
+		size_t end = off + u16(m_idlist);
+		size_t n = 0;
+		bool volume = false;
+
+		while (off + 2 <= end) {
+			size_t cb = u16(off);
+
+			if (cb == 0) {
+				// TerminalID
+				break;
+			}
+
+			if (cb < 3 || off + cb > end) {
+				return NULL;
+			}
+
+			size_t iend = off + cb;
+			BYTE type = m_data[off + 2];
+
+			if (type == 0x1F && !volume && n == 0) {
+				// root folder, the only one expected here is My Computer
+			} else if ((type & 0x70) == 0x20 && !volume) {
+				// volume, e.g. "C:\"
+				n = append(0, off + 3, iend, false);
+				volume = true;
+			} else if ((type & 0x70) == 0x30 && volume && cb >= 16) {
+				// file entry; prefer the long name from the 0xBEEF0004 extension block
+				size_t name = off + 14;
+				bool unicode = (type & 0x04) != 0;
+				size_t ext = 0;
+				size_t longname = 0;
+
+				if (u16(iend - 2) >= 14 && u16(iend - 2) + 8 <= cb) {
+					ext = off + u16(iend - 2);
+
+					if (u32(ext + 4) == 0xBEEF0004 && ext + u16(ext) <= iend) {
+						DWORD version = u16(ext + 2);
+						longname = ext + 18;
+						if (version >= 7) longname += 18;
+						if (version >= 3) longname += 2;
+						if (version >= 9) longname += 4;
+						if (version >= 8) longname += 4;
+						if (version < 3 || longname >= ext + u16(ext)) longname = 0;
+					} else {
+						ext = 0;
+					}
+				}
+
+				n = append_sep(n);
+
+				if (longname != 0) {
+					n = append(n, longname, ext + u16(ext), true);
+				} else {
+					n = append(n, name, ext ? ext : iend, unicode);
+				}
+			} else {
+				// anything else (network, CLSID folders, URIs ...) isn't resolved here
+				return NULL;
+			}
+
+			off = iend;
+		}
+
+		return (n > 0) ? m_buf : NULL;
+	}
+
+
+public:
+
+	shell_link_parser()
+	{}
+
+	~shell_link_parser() {
+		clear();
+		free(m_filebuf);
+	}
+
+	void clear()
+	{
+		m_data = NULL;
+		m_size = 0;
+		m_linksize = 0;
+		m_flags = 0;
+		m_idlist = 0;
+		m_linkinfo = 0;
+		m_extradata = 0;
+		m_envblock = 0;
+		m_iconblock = 0;
+		memset(m_str, 0, sizeof(m_str));
+		m_buf[0] = 0;
+	}
+
+	// Parse a Shell Link from a buffer; trailing data after the link is ignored.
+	// The buffer must stay valid as long as the getters are used.
+	bool load(const void *data, size_t size)
+	{
+		clear();
+
+		m_data = static_cast<const unsigned char *>(data);
+		m_size = size;
+
+		if (!m_data || size < LNK_HEADER_SIZE ||
+			memcmp(m_data, lnk_signature, sizeof(lnk_signature)) != 0)
+		{
+			clear();
+			return false;
+		}
+
+		m_flags = u32(LNK_OFFSET_FLAGS);
+		size_t pos = LNK_HEADER_SIZE;
+
+		// LinkTargetIDList
+		if (m_flags & LNK_HAS_IDLIST) {
+			if (pos + 2 > size || pos + 2 + u16(pos) > size) {
+				clear();
+				return false;
+			}
+			m_idlist = pos;
+			pos += 2 + u16(pos);
+		}
+
+		// LinkInfo
+		if (m_flags & LNK_HAS_LINKINFO) {
+			if (pos + 28 > size || u32(pos) < 28 || u32(pos) > size - pos) {
+				clear();
+				return false;
+			}
+			m_linkinfo = pos;
+			pos += u32(pos);
+		}
+
+		// StringData
+		for (int i = 0; i < STR_COUNT; ++i) {
+			if ((m_flags & (LNK_HAS_NAME << i)) == 0) {
+				continue;
+			}
+
+			if (pos + 2 > size) {
+				clear();
+				return false;
+			}
+
+			size_t len = 2 + u16(pos) * ((m_flags & LNK_IS_UNICODE) ? 2 : 1);
+
+			if (len > size - pos) {
+				clear();
+				return false;
+			}
+
+			m_str[i] = pos;
+			pos += len;
+		}
+
+		// ExtraData, ends with a TerminalBlock (BlockSize < 4)
+		m_extradata = pos;
+
+		while (pos + 4 <= size) {
+			DWORD blocksize = u32(pos);
+
+			if (blocksize < 4) {
+				pos += 4;
+				m_linksize = pos;
+				return true;
+			}
+
+			if (blocksize < 8 || blocksize > size - pos) {
+				clear();
+				return false;
+			}
+
+			DWORD sig = u32(pos + 4);
+
+			if (sig == LNK_BLOCK_ENVIRONMENT && blocksize >= 0x314) {
+				m_envblock = pos;
+			} else if (sig == LNK_BLOCK_ICON_ENV && blocksize >= 0x314) {
+				m_iconblock = pos;
+			}
+
+			pos += blocksize;
+		}
+
+		// tolerate a missing TerminalBlock at the very end of the data
+		if (pos != size) {
+			clear();
+			return false;
+		}
+
+		m_linksize = pos;
+
+		return true;
+	}
+
+	// Read a file into an internal buffer and parse it; files larger than maxsize are rejected.
+	bool load_file(const wchar_t *filename, size_t maxsize = 16*1024*1024)
+	{
+		FILE *fp = compat_wfopen(filename, L"rb");
+		size_t len = 0;
+
+		clear();
+
+		if (!fp) {
+			return false;
+		}
+
+		for (;;) {
+			if (len == m_filebufsize) {
+				size_t newsize = m_filebufsize ? m_filebufsize * 2 : 4096;
+				unsigned char *p;
+
+				if (m_filebufsize >= maxsize ||
+					(p = static_cast<unsigned char *>(realloc(m_filebuf, newsize))) == NULL)
+				{
+					fclose(fp);
+					return false;
+				}
+
+				m_filebuf = p;
+				m_filebufsize = newsize;
+			}
+
+			size_t r = fread(m_filebuf + len, 1, m_filebufsize - len, fp);
+
+			if (r == 0) {
+				break;
+			}
+
+			len += r;
+		}
+
+		bool err = (ferror(fp) != 0);
+		fclose(fp);
+
+		return !err && load(m_filebuf, len);
+	}
+
+	// number of bytes the Shell Link occupies, 0 if nothing was loaded
+	size_t size() const {
+		return m_linksize;
+	}
+
+	// section offsets within the loaded data (0 if not present)
+	size_t idlist_offset() const { return m_idlist; }
+	size_t linkinfo_offset() const { return m_linkinfo; }
+	size_t extradata_offset() const { return m_extradata; }
+
+	const wchar_t *get_path()
+	{
+		const wchar_t *p;
+
+		if (!m_data) {
+			return NULL;
+		}
+
+		if ((p = get_linkinfo_path()) != NULL ||
+			(p = get_idlist_path()) != NULL ||
+			(p = get_env_target(m_envblock)) != NULL)
+		{
+			return p;
+		}
+
+		return get_string(STR_RELATIVE_PATH);
+	}
+
+	const wchar_t *get_relative_path() {
+		return m_data ? get_string(STR_RELATIVE_PATH) : NULL;
+	}
+
+	const wchar_t *get_arguments() {
+		return m_data ? get_string(STR_ARGUMENTS) : NULL;
+	}
+
+	const wchar_t *get_description() {
+		return m_data ? get_string(STR_NAME) : NULL;
+	}
+
+	const wchar_t *get_iconlocation(int &n)
+	{
+		const wchar_t *p = NULL;
+
+		if (!m_data) {
+			return NULL;
+		}
+
+		if ((p = get_string(STR_ICON_LOCATION)) == NULL && (m_flags & LNK_HAS_EXP_ICON)) {
+			p = get_env_target(m_iconblock);
+		}
+
+		if (p) {
+			n = static_cast<int>(u32(LNK_OFFSET_ICONINDEX));
+		}
+
+		return p;
+	}
+
+	const wchar_t *get_workingdir() {
+		return m_data ? get_string(STR_WORKING_DIR) : NULL;
+	}
+
+	bool get_showcmd(int &n)
+	{
+		if (!m_data) {
+			return false;
+		}
+
+		n = static_cast<int>(u32(LNK_OFFSET_SHOWCMD));
+
+		return true;
+	}
+
+	bool get_hotkey(WORD &wHotkey)
+	{
+		if (!m_data) {
+			return false;
+		}
+
+		wHotkey = static_cast<WORD>(u16(LNK_OFFSET_HOTKEY));
+
+		return true;
+	}
+
+	bool get_flags(DWORD &dwFlags)
+	{
+		if (!m_data) {
+			return false;
+		}
+
+		dwFlags = m_flags;
+
+		return true;
+	}
+};
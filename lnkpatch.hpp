@@ -0,0 +1,192 @@
+/*
+Licensed under the MIT License <http://opensource.org/licenses/MIT>.
+SPDX-License-Identifier: MIT
+Copyright (c) 2020-2026 djcj@gmx.de
+
+Permission is hereby  granted, free of charge, to any  person obtaining a copy
+of this software and associated  documentation files (the "Software"), to deal
+in the Software  without restriction, including without  limitation the rights
+to  use, copy,  modify, merge,  publish, distribute,  sublicense, and/or  sell
+copies  of  the Software,  and  to  permit persons  to  whom  the Software  is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE  IS PROVIDED "AS  IS", WITHOUT WARRANTY  OF ANY KIND,  EXPRESS OR
+IMPLIED,  INCLUDING BUT  NOT  LIMITED TO  THE  WARRANTIES OF  MERCHANTABILITY,
+FITNESS FOR  A PARTICULAR PURPOSE AND  NONINFRINGEMENT. IN NO EVENT  SHALL THE
+AUTHORS  OR COPYRIGHT  HOLDERS  BE  LIABLE FOR  ANY  CLAIM,  DAMAGES OR  OTHER
+LIABILITY, WHETHER IN AN ACTION OF  CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE  OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/**
+ * Change fields of the ShellLinkHeader of existing Shell Links in place.
+ *
+ * Only HotKey, ShowCommand and the RunAsUser bit of LinkFlags can be
+ * changed; they are stored at fixed offsets, so nothing else in the file has
+ * to move. The header is validated first and only the bytes that actually
+ * change are written back (one positioned write per file at most).
+ */
+
+#pragma once
+
+#include "compat.hpp"
+#include "lnkparser.hpp"
+
+
+class shell_link_patch
+{
+public:
+
+	// return values of apply()
+	enum {
+		PATCH_ERROR = -1,
+		PATCH_UNCHANGED = 0,
+		PATCH_OK = 1
+	};
+
+
+private:
+
+	bool m_sethotkey = false;
+	WORD m_hotkey = 0;
+	bool m_setshowcmd = false;
+	DWORD m_showcmd = SW_SHOWNORMAL;
+	bool m_setadmin = false;
+	bool m_admin = false;
+
+	static void put32(unsigned char *p, DWORD v)
+	{
+		p[0] = v & 0xff;
+		p[1] = (v >> 8) & 0xff;
+		p[2] = (v >> 16) & 0xff;
+		p[3] = (v >> 24) & 0xff;
+	}
+
+	static DWORD get32(const unsigned char *p) {
+		return p[0] | (p[1] << 8) | (p[2] << 16) | (static_cast<DWORD>(p[3]) << 24);
+	}
+
+
+public:
+
+	shell_link_patch()
+	{}
+
+	void hotkey(WORD w) { m_hotkey = w; m_sethotkey = true; }
+	void admin(bool b) { m_admin = b; m_setadmin = true; }
+
+	void showcmd(int sw)
+	{
+		switch (sw)
+		{
+		case SW_SHOWMAXIMIZED:
+		case SW_SHOWMINNOACTIVE:
+			m_showcmd = sw;
+			break;
+		default:
+			m_showcmd = SW_SHOWNORMAL;
+			break;
+		}
+
+		m_setshowcmd = true;
+	}
+
+	// true if no field would be changed
+	bool empty() const {
+		return !m_sethotkey && !m_setshowcmd && !m_setadmin;
+	}
+
+	// apply the changes to a header in memory
+	void patch_header(unsigned char *hdr) const
+	{
+		if (m_setadmin) {
+			DWORD flags = get32(hdr + LNK_OFFSET_FLAGS);
+			flags = m_admin ? (flags | SLDF_RUNAS_USER) : (flags & ~static_cast<DWORD>(SLDF_RUNAS_USER));
+			put32(hdr + LNK_OFFSET_FLAGS, flags);
+		}
+
+		if (m_setshowcmd) {
+			put32(hdr + LNK_OFFSET_SHOWCMD, m_showcmd);
+		}
+
+		if (m_sethotkey) {
+			hdr[LNK_OFFSET_HOTKEY] = m_hotkey & 0xff;
+			hdr[LNK_OFFSET_HOTKEY + 1] = (m_hotkey >> 8) & 0xff;
+		}
+	}
+
+	int apply(const wchar_t *path) const
+	{
+		unsigned char hdr[LNK_HEADER_SIZE];
+		unsigned char mod[LNK_HEADER_SIZE];
+		size_t first, last;
+		bool ok;
+
+#ifdef _WIN32
+		HANDLE fd = CreateFileW(path, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, NULL,
+								OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+		OVERLAPPED ov;
+		DWORD n = 0;
+
+		if (fd == INVALID_HANDLE_VALUE) {
+			return PATCH_ERROR;
+		}
+
+		memset(&ov, 0, sizeof(ov));
+
+		if (!ReadFile(fd, hdr, sizeof(hdr), &n, &ov) || n != sizeof(hdr)) {
+			CloseHandle(fd);
+			return PATCH_ERROR;
+		}
+#else
+		char bpath[4096];
+
+		compat_wide_to_utf8(path, bpath, sizeof(bpath));
+
+		int fd = open(bpath, O_RDWR);
+
+		if (fd == -1) {
+			return PATCH_ERROR;
+		}
+
+		if (pread(fd, hdr, sizeof(hdr), 0) != static_cast<ssize_t>(sizeof(hdr))) {
+			close(fd);
+			return PATCH_ERROR;
+		}
+#endif
+
+		// validate HeaderSize and LinkCLSID
+		ok = (memcmp(hdr, lnk_signature, sizeof(lnk_signature)) == 0);
+
+		memcpy(mod, hdr, sizeof(hdr));
+		patch_header(mod);
+
+		for (first = 0; first < sizeof(hdr) && hdr[first] == mod[first]; ++first) {}
+		for (last = sizeof(hdr); last > first && hdr[last-1] == mod[last-1]; --last) {}
+
+		if (!ok || first == last) {
+#ifdef _WIN32
+			CloseHandle(fd);
+#else
+			close(fd);
+#endif
+			return ok ? PATCH_UNCHANGED : PATCH_ERROR;
+		}
+
+#ifdef _WIN32
+		memset(&ov, 0, sizeof(ov));
+		ov.Offset = static_cast<DWORD>(first);
+		ok = (WriteFile(fd, mod + first, static_cast<DWORD>(last - first), &n, &ov) && n == last - first);
+		CloseHandle(fd);
+#else
+		ok = (pwrite(fd, mod + first, last - first, first) == static_cast<ssize_t>(last - first));
+		ok = (close(fd) == 0) && ok;
+#endif
+
+		return ok ? PATCH_OK : PATCH_ERROR;
+	}
+};
@@ -0,0 +1,275 @@
+/*
+Licensed under the MIT License <http://opensource.org/licenses/MIT>.
+SPDX-License-Identifier: MIT
+Copyright (c) 2020-2026 djcj@gmx.de
+
+Permission is hereby  granted, free of charge, to any  person obtaining a copy
+of this software and associated  documentation files (the "Software"), to deal
+in the Software  without restriction, including without  limitation the rights
+to  use, copy,  modify, merge,  publish, distribute,  sublicense, and/or  sell
+copies  of  the Software,  and  to  permit persons  to  whom  the Software  is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE  IS PROVIDED "AS  IS", WITHOUT WARRANTY  OF ANY KIND,  EXPRESS OR
+IMPLIED,  INCLUDING BUT  NOT  LIMITED TO  THE  WARRANTIES OF  MERCHANTABILITY,
+FITNESS FOR  A PARTICULAR PURPOSE AND  NONINFRINGEMENT. IN NO EVENT  SHALL THE
+AUTHORS  OR COPYRIGHT  HOLDERS  BE  LIABLE FOR  ANY  CLAIM,  DAMAGES OR  OTHER
+LIABILITY, WHETHER IN AN ACTION OF  CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE  OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/**
+ * Follow chains of Shell Links that point to other Shell Links down to the
+ * final target.
+ *
+ * Every link that has been resolved is memoized in a map shared by all
+ * threads (split into independently locked shards), so links that share an
+ * intermediate link only parse it once and resolving a whole tree stays close
+ * to linear in the number of distinct links. Cycles are detected per chain;
+ * chains longer than the depth limit are reported as such.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "compat.hpp"
+#include "compat_thread.hpp"
+#include "drivemap.hpp"
+#include "filelist.hpp"
+#include "lnkparser.hpp"
+
+
+struct resolve_result
+{
+	enum {
+		RESOLVE_OK = 0,
+		RESOLVE_NO_TARGET,   // link has no target path
+		RESOLVE_ERROR,       // link (or a link in the chain) couldn't be loaded
+		RESOLVE_CYCLE,       // chain leads into a cycle
+		RESOLVE_DEPTH        // chain is longer than the depth limit
+	};
+
+	int status = RESOLVE_ERROR;
+	std::wstring target;     // final target, or the link that caused the error
+	unsigned hops = 0;       // number of links in the chain, including the first one
+};
+
+
+class lnk_resolver
+{
+private:
+
+	enum { SHARDS = 64 };
+
+	struct shard
+	{
+		compat_mutex lock;
+		std::unordered_map<std::wstring, resolve_result> memo;
+	};
+
+	const drive_map &m_drives;
+	unsigned m_maxdepth;
+	shard m_shards[SHARDS];
+
+	// work list for run()
+	const std::vector<std::wstring> *m_files = NULL;
+	std::vector<resolve_result> *m_results = NULL;
+	std::atomic<size_t> m_next;
+
+
+	shard &shard_for(const std::wstring &key) {
+		return m_shards[std::hash<std::wstring>()(key) % SHARDS];
+	}
+
+	bool lookup(const std::wstring &key, resolve_result &res)
+	{
+		shard &s = shard_for(key);
+		bool found;
+
+		s.lock.lock();
+		std::unordered_map<std::wstring, resolve_result>::const_iterator it = s.memo.find(key);
+		found = (it != s.memo.end());
+		if (found) res = it->second;
+		s.lock.unlock();
+
+		return found;
+	}
+
+	void store(const std::wstring &key, const resolve_result &res)
+	{
+		shard &s = shard_for(key);
+
+		s.lock.lock();
+		s.memo[key] = res;
+		s.lock.unlock();
+	}
+
+	// absolute, case-folded (on Windows) path used as memo key
+	static std::wstring make_key(const std::wstring &path)
+	{
+#ifdef _WIN32
+		wchar_t *full = _wfullpath(NULL, path.c_str(), 0);
+		std::wstring key = full ? full : path;
+
+		free(full);
+
+		for (size_t i = 0; i < key.size(); ++i) {
+			key[i] = towlower(key[i]);
+		}
+
+		return key;
+#else
+		char bpath[4096];
+		wchar_t wpath[4096];
+
+		compat_wide_to_utf8(path.c_str(), bpath, sizeof(bpath));
+		char *full = realpath(bpath, NULL);
+
+		if (!full) {
+			return path;
+		}
+
+		compat_utf8_to_wide(full, strlen(full), wpath, _countof(wpath));
+		free(full);
+
+		return wpath;
+#endif
+	}
+
+	static void worker(void *arg)
+	{
+		lnk_resolver *self = static_cast<lnk_resolver *>(arg);
+		shell_link_parser *parser = new shell_link_parser;
+		size_t i;
+
+		while ((i = self->m_next++) < self->m_files->size()) {
+			(*self->m_results)[i] = self->resolve((*self->m_files)[i], *parser);
+		}
+
+		delete parser;
+	}
+
+
+public:
+
+	lnk_resolver(const drive_map &drives, unsigned maxdepth = 32)
+	: m_drives(drives),
+	  m_maxdepth(maxdepth),
+	  m_next(0)
+	{}
+
+	// Resolve the chain starting at the local Shell Link file path.
+	resolve_result resolve(const std::wstring &path, shell_link_parser &parser)
+	{
+		std::vector<std::wstring> chain;
+		resolve_result res;
+		std::wstring cur = make_key(path);
+		unsigned base = 0;    // hops of a memoized result the chain ended in
+		bool memoize = true;
+
+		for (;;) {
+			// A memoized result only counts if the whole chain stays within
+			// the limit; otherwise walk on to report where the limit is hit.
+			if (lookup(cur, res) && chain.size() + res.hops <= m_maxdepth) {
+				base = res.hops;
+				break;
+			}
+
+			bool cycle = false;
+			for (size_t i = 0; i < chain.size() && !cycle; ++i) {
+				cycle = (chain[i] == cur);
+			}
+
+			if (cycle) {
+				res.status = resolve_result::RESOLVE_CYCLE;
+				res.target = cur;
+				break;
+			}
+
+			if (chain.size() >= m_maxdepth) {
+				// not memoized, links further down the chain may be within the limit
+				res.status = resolve_result::RESOLVE_DEPTH;
+				res.target = cur;
+				memoize = false;
+				break;
+			}
+
+			chain.push_back(cur);
+
+			if (!parser.load_file(cur.c_str())) {
+				res.status = resolve_result::RESOLVE_ERROR;
+				res.target = cur;
+				break;
+			}
+
+			const wchar_t *target = parser.get_path();
+
+			if (!target) {
+				res.status = resolve_result::RESOLVE_NO_TARGET;
+				res.target.clear();
+				break;
+			}
+
+			std::wstring local;
+
+			if (!is_lnk_filename(target) || !m_drives.translate(target, local)) {
+				res.status = resolve_result::RESOLVE_OK;
+				res.target = target;
+				break;
+			}
+
+			cur = make_key(local);
+		}
+
+		if (chain.empty()) {
+			return res;
+		}
+
+		for (size_t i = chain.size(); i-- > 0; ) {
+			res.hops = base + static_cast<unsigned>(chain.size() - i);
+
+			if (memoize) {
+				store(chain[i], res);
+			}
+		}
+
+		return res;
+	}
+
+	// Resolve all files with nthreads threads (0 = one per processor);
+	// results[i] belongs to files[i].
+	void run(const std::vector<std::wstring> &files, std::vector<resolve_result> &results,
+				unsigned nthreads = 0)
+	{
+		results.assign(files.size(), resolve_result());
+		m_files = &files;
+		m_results = &results;
+		m_next = 0;
+
+		if (nthreads == 0) {
+			nthreads = compat_cpu_count();
+		}
+
+		compat_thread *threads = new compat_thread[nthreads];
+		unsigned started = 0;
+
+		for (unsigned i = 0; i < nthreads; ++i) {
+			if (threads[i].start(worker, this)) {
+				++started;
+			}
+		}
+
+		if (started == 0) {
+			worker(this);
+		}
+
+		delete[] threads;
+	}
+};
@@ -0,0 +1,509 @@
+/*
+Licensed under the MIT License <http://opensource.org/licenses/MIT>.
+SPDX-License-Identifier: MIT
+Copyright (c) 2020-2026 djcj@gmx.de
+
+Permission is hereby  granted, free of charge, to any  person obtaining a copy
+of this software and associated  documentation files (the "Software"), to deal
+in the Software  without restriction, including without  limitation the rights
+to  use, copy,  modify, merge,  publish, distribute,  sublicense, and/or  sell
+copies  of  the Software,  and  to  permit persons  to  whom  the Software  is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE  IS PROVIDED "AS  IS", WITHOUT WARRANTY  OF ANY KIND,  EXPRESS OR
+IMPLIED,  INCLUDING BUT  NOT  LIMITED TO  THE  WARRANTIES OF  MERCHANTABILITY,
+FITNESS FOR  A PARTICULAR PURPOSE AND  NONINFRINGEMENT. IN NO EVENT  SHALL THE
+AUTHORS  OR COPYRIGHT  HOLDERS  BE  LIABLE FOR  ANY  CLAIM,  DAMAGES OR  OTHER
+LIABILITY, WHETHER IN AN ACTION OF  CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE  OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/**
+ * Aggregate statistics over very large sets of Shell Links in fixed memory.
+ *
+ * Exact counters are kept for everything that has a small domain (show
+ * command, "Run as Administrator", hotkey modifiers and a count per possible
+ * hotkey value to find collisions). Distinct targets and icon sources are
+ * estimated with HyperLogLog sketches and the most common targets are tracked
+ * with the Space-Saving algorithm. All of them can be merged, so every reader
+ * thread aggregates on its own and the partial results are combined at the
+ * end; memory use doesn't grow with the number of links.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cwctype>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "compat.hpp"
+#include "filelist.hpp"
+#include "lnkparser.hpp"
+#include "readsched.hpp"
+
+
+// 64 bit FNV-1a of a string (case folded) with a final mix, so that the
+// high bits are usable as HyperLogLog register index
+inline unsigned long long stats_hash(const std::wstring &s)
+{
+	unsigned long long h = 0xcbf29ce484222325ULL;
+
+	for (size_t i = 0; i < s.size(); ++i) {
+		h ^= static_cast<unsigned long long>(s[i]);
+		h *= 0x100000001b3ULL;
+	}
+
+	h ^= h >> 33;
+	h *= 0xff51afd7ed558ccdULL;
+	h ^= h >> 33;
+	h *= 0xc4ceb9fe1a85ec53ULL;
+	h ^= h >> 33;
+
+	return h;
+}
+
+// Windows paths are case insensitive
+inline void stats_fold(const wchar_t *in, std::wstring &out)
+{
+	out.clear();
+
+	for ( ; *in != 0; ++in) {
+		out += static_cast<wchar_t>(towlower(*in));
+	}
+}
+
+
+// HyperLogLog with 2^14 registers (about 0.8% standard error)
+class hyperloglog
+{
+private:
+
+	enum { BITS = 14, REGISTERS = 1 << BITS };
+
+	unsigned char m_reg[REGISTERS] = {0};
+
+
+public:
+
+	void add(unsigned long long hash)
+	{
+		size_t idx = static_cast<size_t>(hash >> (64 - BITS));
+		unsigned long long w = (hash << BITS) | (1ULL << (BITS - 1));
+		unsigned char rank = 1;
+
+		while ((w & (1ULL << 63)) == 0) {
+			w <<= 1;
+			++rank;
+		}
+
+		if (rank > m_reg[idx]) {
+			m_reg[idx] = rank;
+		}
+	}
+
+	void merge(const hyperloglog &other)
+	{
+		for (size_t i = 0; i < REGISTERS; ++i) {
+			if (other.m_reg[i] > m_reg[i]) m_reg[i] = other.m_reg[i];
+		}
+	}
+
+	unsigned long long estimate() const
+	{
+		const double m = REGISTERS;
+		double sum = 0;
+		size_t zeros = 0;
+
+		for (size_t i = 0; i < REGISTERS; ++i) {
+			sum += std::ldexp(1.0, -static_cast<int>(m_reg[i]));
+			if (m_reg[i] == 0) ++zeros;
+		}
+
+		double e = (0.7213 / (1.0 + 1.079 / m)) * m * m / sum;
+
+		// linear counting is more accurate for small sets
+		if (e <= 2.5 * m && zeros > 0) {
+			e = m * std::log(m / zeros);
+		}
+
+		return static_cast<unsigned long long>(e + 0.5);
+	}
+};
+
+
+// Space-Saving top-k: counts are upper bounds, count - error lower bounds.
+// Every key that occurs more often than total/capacity is guaranteed to be
+// tracked.
+class space_saving
+{
+public:
+
+	struct entry
+	{
+		std::wstring key;
+		unsigned long long count;
+		unsigned long long error;
+	};
+
+
+private:
+
+	struct counter
+	{
+		unsigned long long count;
+		unsigned long long error;
+		size_t pos;    // position in m_heap
+	};
+
+	typedef std::unordered_map<std::wstring, counter> map_type;
+
+	size_t m_capacity;
+	map_type m_map;
+	std::vector<map_type::value_type *> m_heap;   // min-heap on count
+
+
+	void swap_nodes(size_t a, size_t b)
+	{
+		std::swap(m_heap[a], m_heap[b]);
+		m_heap[a]->second.pos = a;
+		m_heap[b]->second.pos = b;
+	}
+
+	void sift_up(size_t i)
+	{
+		while (i > 0 && m_heap[(i-1)/2]->second.count > m_heap[i]->second.count) {
+			swap_nodes(i, (i-1)/2);
+			i = (i-1)/2;
+		}
+	}
+
+	void sift_down(size_t i)
+	{
+		for (;;) {
+			size_t l = 2*i + 1;
+			size_t r = l + 1;
+			size_t min = i;
+
+			if (l < m_heap.size() && m_heap[l]->second.count < m_heap[min]->second.count) min = l;
+			if (r < m_heap.size() && m_heap[r]->second.count < m_heap[min]->second.count) min = r;
+
+			if (min == i) {
+				break;
+			}
+
+			swap_nodes(i, min);
+			i = min;
+		}
+	}
+
+	void insert(const std::wstring &key, unsigned long long count, unsigned long long error)
+	{
+		map_type::value_type *p = &*m_map.emplace(key, counter{count, error, m_heap.size()}).first;
+		m_heap.push_back(p);
+		sift_up(p->second.pos);
+	}
+
+	// count assumed for keys that aren't tracked
+	unsigned long long untracked() const {
+		return (m_heap.size() < m_capacity) ? 0 : m_heap[0]->second.count;
+	}
+
+
+public:
+
+	space_saving(size_t capacity)
+	: m_capacity(capacity ? capacity : 1)
+	{
+		m_map.reserve(m_capacity);
+		m_heap.reserve(m_capacity);
+	}
+
+	void add(const std::wstring &key)
+	{
+		map_type::iterator it = m_map.find(key);
+
+		if (it != m_map.end()) {
+			++it->second.count;
+			sift_down(it->second.pos);
+		} else if (m_heap.size() < m_capacity) {
+			insert(key, 1, 0);
+		} else {
+			// replace the smallest counter
+			unsigned long long min = m_heap[0]->second.count;
+
+			m_map.erase(m_heap[0]->first);
+			m_heap[0] = &*m_map.emplace(key, counter{min + 1, min, 0}).first;
+			sift_down(0);
+		}
+	}
+
+	// Merge another summary into this one; keys missing on one side are
+	// assumed to have that side's smallest count, which keeps the bounds.
+	void merge(const space_saving &other)
+	{
+		unsigned long long mine = untracked();
+		unsigned long long theirs = other.untracked();
+		std::vector<entry> all;
+
+		all.reserve(m_map.size() + other.m_map.size());
+
+		for (map_type::const_iterator it = m_map.begin(); it != m_map.end(); ++it) {
+			map_type::const_iterator o = other.m_map.find(it->first);
+
+			if (o != other.m_map.end()) {
+				all.push_back(entry{it->first, it->second.count + o->second.count,
+									it->second.error + o->second.error});
+			} else {
+				all.push_back(entry{it->first, it->second.count + theirs, it->second.error + theirs});
+			}
+		}
+
+		for (map_type::const_iterator o = other.m_map.begin(); o != other.m_map.end(); ++o) {
+			if (m_map.find(o->first) == m_map.end()) {
+				all.push_back(entry{o->first, o->second.count + mine, o->second.error + mine});
+			}
+		}
+
+		if (all.size() > m_capacity) {
+			std::nth_element(all.begin(), all.begin() + m_capacity, all.end(),
+				[](const entry &a, const entry &b) { return a.count > b.count; });
+			all.resize(m_capacity);
+		}
+
+		m_map.clear();
+		m_heap.clear();
+
+		for (size_t i = 0; i < all.size(); ++i) {
+			insert(all[i].key, all[i].count, all[i].error);
+		}
+	}
+
+	// the n largest counters, largest first
+	std::vector<entry> top(size_t n) const
+	{
+		std::vector<entry> out;
+
+		for (map_type::const_iterator it = m_map.begin(); it != m_map.end(); ++it) {
+			out.push_back(entry{it->first, it->second.count, it->second.error});
+		}
+
+		std::sort(out.begin(), out.end(), [](const entry &a, const entry &b) {
+			return (a.count != b.count) ? a.count > b.count : a.key < b.key;
+		});
+
+		if (out.size() > n) {
+			out.resize(n);
+		}
+
+		return out;
+	}
+};
+
+
+struct link_stats
+{
+	enum {
+		SHOW_NORMAL = 0,
+		SHOW_MAXIMIZED,
+		SHOW_MINNOACTIVE,
+		SHOW_OTHER,
+		SHOW_MAX
+	};
+
+	unsigned long long links = 0;        // valid Shell Links
+	unsigned long long failed = 0;       // files that couldn't be loaded
+	unsigned long long no_target = 0;
+	unsigned long long runas = 0;
+	unsigned long long with_icon = 0;
+	unsigned long long with_hotkey = 0;
+	unsigned long long showcmd[SHOW_MAX] = {0};
+	unsigned long long modifiers[16] = {0};   // indexed by the HOTKEYF_* bits
+	std::vector<unsigned> hotkeys;           // links per hotkey value
+	hyperloglog targets;
+	hyperloglog icons;
+	space_saving top_targets;
+
+	std::wstring tmp;                        // scratch buffer for add()
+
+
+	link_stats(size_t topk_capacity)
+	: hotkeys(0x10000, 0),
+	  top_targets(topk_capacity)
+	{}
+
+	void add(shell_link_parser &shl)
+	{
+		const wchar_t *p;
+		DWORD dwFlags = 0;
+		WORD wHotkey = 0;
+		int n = 0;
+
+		++links;
+
+		// the returned strings share one buffer, use them right away
+		if ((p = shl.get_path()) != NULL) {
+			stats_fold(p, tmp);
+			targets.add(stats_hash(tmp));
+			top_targets.add(tmp);
+		} else {
+			++no_target;
+		}
+
+		if ((p = shl.get_iconlocation(n)) != NULL) {
+			stats_fold(p, tmp);
+			icons.add(stats_hash(tmp));
+			++with_icon;
+		}
+
+		if (shl.get_showcmd(n)) {
+			switch(n)
+			{
+			case SW_SHOWNORMAL:
+				++showcmd[SHOW_NORMAL];
+				break;
+			case SW_SHOWMAXIMIZED:
+				++showcmd[SHOW_MAXIMIZED];
+				break;
+			case SW_SHOWMINNOACTIVE:
+				++showcmd[SHOW_MINNOACTIVE];
+				break;
+			default:
+				++showcmd[SHOW_OTHER];
+				break;
+			}
+		}
+
+		if (shl.get_hotkey(wHotkey) && wHotkey != 0) {
+			++with_hotkey;
+			++hotkeys[wHotkey];
+			++modifiers[(wHotkey >> 8) & 0x0f];
+		}
+
+		if (shl.get_flags(dwFlags) && (dwFlags & SLDF_RUNAS_USER)) {
+			++runas;
+		}
+	}
+
+	void merge(const link_stats &other)
+	{
+		links += other.links;
+		failed += other.failed;
+		no_target += other.no_target;
+		runas += other.runas;
+		with_icon += other.with_icon;
+		with_hotkey += other.with_hotkey;
+
+		for (size_t i = 0; i < SHOW_MAX; ++i) showcmd[i] += other.showcmd[i];
+		for (size_t i = 0; i < 16; ++i) modifiers[i] += other.modifiers[i];
+		for (size_t i = 0; i < hotkeys.size(); ++i) hotkeys[i] += other.hotkeys[i];
+
+		targets.merge(other.targets);
+		icons.merge(other.icons);
+		top_targets.merge(other.top_targets);
+	}
+
+	// number of hotkeys assigned to more than one link and the links involved
+	unsigned long long collisions(unsigned long long &nlinks) const
+	{
+		unsigned long long n = 0;
+
+		nlinks = 0;
+
+		for (size_t i = 0; i < hotkeys.size(); ++i) {
+			if (hotkeys[i] > 1) {
+				++n;
+				nlinks += hotkeys[i];
+			}
+		}
+
+		return n;
+	}
+};
+
+
+class link_summary
+{
+private:
+
+	// files are collected and read in chunks of this size
+	enum { CHUNK = 64*1024 };
+
+	size_t m_capacity;
+	read_scheduler m_sched;
+	std::vector<link_stats *> m_slots;            // one per reader thread
+	std::vector<shell_link_parser *> m_parsers;
+	link_stats m_stats;
+
+
+	void process(std::vector<std::wstring> &chunk)
+	{
+		m_sched.run(chunk, [this](unsigned slot, size_t, const unsigned char *data, size_t size) {
+			if (data && m_parsers[slot]->load(data, size)) {
+				m_slots[slot]->add(*m_parsers[slot]);
+			} else {
+				++m_slots[slot]->failed;
+			}
+		});
+
+		chunk.clear();
+	}
+
+
+public:
+
+	// topk_capacity counters are used to track the most common targets
+	link_summary(size_t topk_capacity = 1000)
+	: m_capacity(topk_capacity),
+	  m_stats(topk_capacity)
+	{}
+
+	// Aggregate all Shell Links below inputs (files or directories); inputs
+	// that don't exist are added to missing. Directories are walked in
+	// chunks, the full file list is never held in memory.
+	void run(const std::vector<const wchar_t *> &inputs, std::vector<const wchar_t *> &missing)
+	{
+		std::vector<std::wstring> chunk;
+
+		for (unsigned i = 0; i < m_sched.threads(); ++i) {
+			m_slots.push_back(new link_stats(m_capacity));
+			m_parsers.push_back(new shell_link_parser);
+		}
+
+		for (size_t i = 0; i < inputs.size(); ++i) {
+			bool found = walk_lnk_files(inputs[i], [this, &chunk](const std::wstring &file) {
+				chunk.push_back(file);
+
+				if (chunk.size() == CHUNK) {
+					process(chunk);
+				}
+			});
+
+			if (!found) {
+				missing.push_back(inputs[i]);
+			}
+		}
+
+		if (!chunk.empty()) {
+			process(chunk);
+		}
+
+		for (size_t i = 0; i < m_slots.size(); ++i) {
+			m_stats.merge(*m_slots[i]);
+			delete m_slots[i];
+			delete m_parsers[i];
+		}
+
+		m_slots.clear();
+		m_parsers.clear();
+	}
+
+	const link_stats &stats() const {
+		return m_stats;
+	}
+};
@@ -0,0 +1,669 @@
+/*
+Licensed under the MIT License <http://opensource.org/licenses/MIT>.
+SPDX-License-Identifier: MIT
+Copyright (c) 2020-2026 djcj@gmx.de
+
+Permission is hereby  granted, free of charge, to any  person obtaining a copy
+of this software and associated  documentation files (the "Software"), to deal
+in the Software  without restriction, including without  limitation the rights
+to  use, copy,  modify, merge,  publish, distribute,  sublicense, and/or  sell
+copies  of  the Software,  and  to  permit persons  to  whom  the Software  is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE  IS PROVIDED "AS  IS", WITHOUT WARRANTY  OF ANY KIND,  EXPRESS OR
+IMPLIED,  INCLUDING BUT  NOT  LIMITED TO  THE  WARRANTIES OF  MERCHANTABILITY,
+FITNESS FOR  A PARTICULAR PURPOSE AND  NONINFRINGEMENT. IN NO EVENT  SHALL THE
+AUTHORS  OR COPYRIGHT  HOLDERS  BE  LIABLE FOR  ANY  CLAIM,  DAMAGES OR  OTHER
+LIABILITY, WHETHER IN AN ACTION OF  CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE  OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/**
+ * Sequential reader for Shell Links stored in tar or zip archives, or a single
+ * Shell Link passed through a pipe. The input is read strictly front to back
+ * (no seeking, no temporary files), so it works on stdin and on archives of any
+ * size. Members ending on .lnk are read into one reused buffer, everything else
+ * is read over and discarded.
+ *
+ * Zip members can be stored or deflated; other compression methods and
+ * encrypted members are reported as unsupported. Zip archives written to a
+ * pipe have the compressed sizes after the data; deflated members end by
+ * themselves and stored members carry their size, any other member of that
+ * kind ends the stream since there is no way to find its end.
+ */
+
+#pragma once
+
+#include "compat.hpp"
+#include "inflate.hpp"
+#include "lnkparser.hpp"
+
+
+class archive_reader
+{
+public:
+
+	enum {
+		FORMAT_UNKNOWN = 0,
+		FORMAT_RAW,
+		FORMAT_TAR,
+		FORMAT_ZIP
+	};
+
+	// return values of next()
+	enum {
+		MEMBER_ERROR = -1,
+		MEMBER_END = 0,
+		MEMBER_OK,           // data is available
+		MEMBER_TOO_LARGE,    // skipped, larger than the member size limit
+		MEMBER_UNSUPPORTED,  // skipped, unknown compression method or encrypted zip member
+		MEMBER_CORRUPT       // skipped, compressed data of a zip member is invalid
+	};
+
+
+private:
+
+	FILE *m_fp = NULL;
+	int m_format = FORMAT_UNKNOWN;
+	const wchar_t *m_error = NULL;
+
+	// data read ahead while detecting the format
+	unsigned char m_peek[512] = {0};
+	size_t m_peeklen = 0;
+	size_t m_peekpos = 0;
+
+	unsigned char *m_buf = NULL;  // member data, reused
+	size_t m_bufsize = 0;
+	size_t m_maxmember;           // members larger than this are skipped
+
+	char m_name[4096] = {0};      // current member name (UTF-8)
+	char m_longname[4096] = {0};  // name from a preceding GNU 'L' or pax 'x' header
+
+
+	size_t read(void *dst, size_t len)
+	{
+		unsigned char *p = static_cast<unsigned char *>(dst);
+		size_t n = 0;
+
+		if (m_peekpos < m_peeklen) {
+			n = m_peeklen - m_peekpos;
+			if (n > len) n = len;
+			memcpy(p, m_peek + m_peekpos, n);
+			m_peekpos += n;
+		}
+
+		if (n < len) {
+			n += fread(p + n, 1, len - n, m_fp);
+		}
+
+		return n;
+	}
+
+	bool read_exact(void *dst, size_t len) {
+		return read(dst, len) == len;
+	}
+
+	// Give back the last len bytes of what the last read() returned.
+	void unread(const unsigned char *p, size_t len)
+	{
+		if (m_peekpos < m_peeklen) {
+			// that read came from m_peek alone, the bytes are still there
+			m_peekpos -= len;
+		} else {
+			memcpy(m_peek, p, len);
+			m_peeklen = len;
+			m_peekpos = 0;
+		}
+	}
+
+	// input for raw_inflater, in pieces small enough for unread()
+	static size_t inflate_input(void *ctx, unsigned char *buf, size_t len)
+	{
+		archive_reader *self = static_cast<archive_reader *>(ctx);
+
+		return self->read(buf, (len < sizeof(self->m_peek)) ? len : sizeof(self->m_peek));
+	}
+
+	// read over len bytes; pipes can't seek
+	bool skip(unsigned long long len)
+	{
+		unsigned char tmp[64*1024];
+
+		while (len > 0) {
+			size_t n = (len > sizeof(tmp)) ? sizeof(tmp) : static_cast<size_t>(len);
+
+			if (!read_exact(tmp, n)) {
+				return false;
+			}
+
+			len -= n;
+		}
+
+		return true;
+	}
+
+	bool reserve(size_t len)
+	{
+		if (len <= m_bufsize) {
+			return true;
+		}
+
+		unsigned char *p = static_cast<unsigned char *>(realloc(m_buf, len));
+
+		if (!p) {
+			return false;
+		}
+
+		m_buf = p;
+		m_bufsize = len;
+
+		return true;
+	}
+
+	static bool is_lnk_name(const char *name)
+	{
+		size_t len = strlen(name);
+
+		return (len >= 4 && name[len-4] == '.' &&
+				(name[len-3] | 0x20) == 'l' &&
+				(name[len-2] | 0x20) == 'n' &&
+				(name[len-1] | 0x20) == 'k');
+	}
+
+	static unsigned long long tar_number(const unsigned char *p, size_t len)
+	{
+		unsigned long long n = 0;
+
+		if (p[0] & 0x80) {
+			// GNU base-256 encoding
+			n = p[0] & 0x7F;
+			for (size_t i = 1; i < len; ++i) {
+				n = (n << 8) | p[i];
+			}
+			return n;
+		}
+
+		for (size_t i = 0; i < len && p[i] != 0; ++i) {
+			if (p[i] >= '0' && p[i] <= '7') {
+				n = (n << 3) | (p[i] - '0');
+			} else if (p[i] != ' ') {
+				break;
+			}
+		}
+
+		return n;
+	}
+
+	static bool tar_checksum_ok(const unsigned char *hdr)
+	{
+		unsigned long sum = 0;
+
+		for (size_t i = 0; i < 512; ++i) {
+			sum += (i >= 148 && i < 156) ? ' ' : hdr[i];
+		}
+
+		return sum == tar_number(hdr + 148, 8);
+	}
+
+	// copy len bytes of a (not necessarily NUL-terminated) name
+	static void set_name(char *dst, size_t dstlen, const void *src, size_t len)
+	{
+		if (len >= dstlen) {
+			len = dstlen - 1;
+		}
+		memcpy(dst, src, len);
+		dst[len] = 0;
+		dst[strnlen(dst, len)] = 0;
+	}
+
+	// read the data of a GNU long name or pax header into m_longname
+	bool tar_read_longname(bool pax, unsigned long long size)
+	{
+		unsigned long long padded = (size + 511) & ~511ULL;
+
+		if (size >= sizeof(m_longname) * 4) {
+			return skip(padded);
+		}
+
+		if (!reserve(static_cast<size_t>(padded) + 1) || !read_exact(m_buf, static_cast<size_t>(padded))) {
+			return false;
+		}
+
+		m_buf[size] = 0;
+
+		if (!pax) {
+			set_name(m_longname, sizeof(m_longname), m_buf, static_cast<size_t>(size));
+			return true;
+		}
+
+		// records: "<length> <key>=<value>\n"
+		size_t pos = 0;
+
+		while (pos < size) {
+			char *rec = reinterpret_cast<char *>(m_buf + pos);
+			unsigned long len = strtoul(rec, NULL, 10);
+
+			if (len == 0 || len > size - pos) {
+				break;
+			}
+
+			// the key must start within this record
+			char *key = static_cast<char *>(memchr(rec, ' ', len));
+
+			if (!key) {
+				break;
+			}
+
+			if (key + 6 <= rec + len && memcmp(key + 1, "path=", 5) == 0) {
+				char *value = key + 6;
+				size_t vlen = (rec + len) - value;
+
+				if (vlen > 0 && value[vlen-1] == '\n') {
+					--vlen;
+				}
+				set_name(m_longname, sizeof(m_longname), value, vlen);
+			}
+
+			pos += len;
+		}
+
+		return true;
+	}
+
+	int next_tar(const char *&name, const unsigned char *&data, size_t &size)
+	{
+		unsigned char hdr[512];
+
+		for (;;) {
+			if (!read_exact(hdr, sizeof(hdr))) {
+				m_error = L"unexpected end of tar archive";
+				return MEMBER_ERROR;
+			}
+
+			// two zero blocks end the archive; one is enough to stop here
+			bool zero = true;
+			for (size_t i = 0; i < sizeof(hdr) && zero; ++i) {
+				zero = (hdr[i] == 0);
+			}
+			if (zero) {
+				return MEMBER_END;
+			}
+
+			if (!tar_checksum_ok(hdr)) {
+				m_error = L"invalid tar header checksum";
+				return MEMBER_ERROR;
+			}
+
+			unsigned long long len = tar_number(hdr + 124, 12);
+			unsigned long long padded = (len + 511) & ~511ULL;
+			char type = static_cast<char>(hdr[156]);
+
+			if (type == 'L' || type == 'x') {
+				if (!tar_read_longname(type == 'x', len)) {
+					m_error = L"unexpected end of tar archive";
+					return MEMBER_ERROR;
+				}
+				continue;
+			}
+
+			if (type != '0' && type != '\0' && type != '7') {
+				// directories, links, devices, global pax headers ...
+				m_longname[0] = 0;
+				if (!skip(padded)) {
+					m_error = L"unexpected end of tar archive";
+					return MEMBER_ERROR;
+				}
+				continue;
+			}
+
+			if (m_longname[0] != 0) {
+				memcpy(m_name, m_longname, sizeof(m_name));
+				m_longname[0] = 0;
+			} else if (memcmp(hdr + 257, "ustar", 6) == 0 && hdr[345] != 0) {
+				char prefix[156];
+				char base[101];
+				set_name(prefix, sizeof(prefix), hdr + 345, 155);
+				set_name(base, sizeof(base), hdr, 100);
+				snprintf(m_name, sizeof(m_name), "%s/%s", prefix, base);
+			} else {
+				set_name(m_name, sizeof(m_name), hdr, 100);
+			}
+
+			if (!is_lnk_name(m_name)) {
+				if (!skip(padded)) {
+					m_error = L"unexpected end of tar archive";
+					return MEMBER_ERROR;
+				}
+				continue;
+			}
+
+			name = m_name;
+			data = NULL;
+			size = 0;
+
+			if (len > m_maxmember) {
+				if (!skip(padded)) {
+					m_error = L"unexpected end of tar archive";
+					return MEMBER_ERROR;
+				}
+				return MEMBER_TOO_LARGE;
+			}
+
+			if (!reserve(static_cast<size_t>(padded)) || !read_exact(m_buf, static_cast<size_t>(padded))) {
+				m_error = L"unexpected end of tar archive";
+				return MEMBER_ERROR;
+			}
+
+			data = m_buf;
+			size = static_cast<size_t>(len);
+
+			return MEMBER_OK;
+		}
+	}
+
+	// read over the data descriptor that follows the member data if bit 3 of
+	// the general purpose flags is set; its signature is optional
+	bool zip_skip_descriptor(DWORD gpflags, bool zip64)
+	{
+		unsigned char dd[24];
+
+		if ((gpflags & 0x08) == 0) {
+			return true;
+		}
+
+		if (!read_exact(dd, 4)) {
+			return false;
+		}
+
+		bool sig = (dd[0] == 0x50 && dd[1] == 0x4B && dd[2] == 0x07 && dd[3] == 0x08);
+
+		return read_exact(dd + 4, (zip64 ? 16 : 8) + (sig ? 4 : 0));
+	}
+
+	// Inflate a member whose compressed size isn't known up front and read
+	// over its data descriptor; the data is kept in m_buf if keep is set.
+	// Returns MEMBER_OK, MEMBER_TOO_LARGE, MEMBER_CORRUPT or MEMBER_ERROR.
+	int zip_inflate_stream(bool keep, unsigned long long usize, DWORD gpflags, bool zip64, size_t &size)
+	{
+		size_t cap = 0;
+		const unsigned char *rest;
+		size_t restlen;
+
+		if (keep) {
+			cap = (usize != 0 && usize < m_maxmember) ? static_cast<size_t>(usize) : m_maxmember;
+
+			if (!reserve(cap + 1)) {
+				m_error = L"out of memory";
+				return MEMBER_ERROR;
+			}
+		}
+
+		raw_inflater z(inflate_input, this);
+		bool ok = z.run(keep ? m_buf : NULL, cap);
+
+		z.unused(rest, restlen);
+		unread(rest, restlen);
+
+		if (!ok) {
+			// without a valid end there is no way to find the next member
+			m_error = L"invalid compressed data in zip member";
+			return MEMBER_ERROR;
+		}
+
+		if (!zip_skip_descriptor(gpflags, zip64)) {
+			m_error = L"unexpected end of zip archive";
+			return MEMBER_ERROR;
+		}
+
+		if (z.size() > cap) {
+			return MEMBER_TOO_LARGE;
+		}
+
+		if (usize != 0 && z.size() != usize) {
+			return MEMBER_CORRUPT;
+		}
+
+		size = static_cast<size_t>(z.size());
+
+		return MEMBER_OK;
+	}
+
+	int next_zip(const char *&name, const unsigned char *&data, size_t &size)
+	{
+		unsigned char hdr[30];
+
+		for (;;) {
+			if (!read_exact(hdr, 4)) {
+				// archive without central directory
+				return MEMBER_END;
+			}
+
+			DWORD sig = hdr[0] | (hdr[1] << 8) | (hdr[2] << 16) | (static_cast<DWORD>(hdr[3]) << 24);
+
+			if (sig == 0x02014B50 || sig == 0x06054B50 || sig == 0x06064B50 || sig == 0x05054B50) {
+				// central directory, end of central directory record or digital signature
+				return MEMBER_END;
+			}
+
+			if (sig != 0x04034B50) {
+				m_error = L"invalid zip header";
+				return MEMBER_ERROR;
+			}
+
+			if (!read_exact(hdr + 4, sizeof(hdr) - 4)) {
+				m_error = L"unexpected end of zip archive";
+				return MEMBER_ERROR;
+			}
+
+			DWORD gpflags = hdr[6] | (hdr[7] << 8);
+			DWORD method = hdr[8] | (hdr[9] << 8);
+			unsigned long long csize = hdr[18] | (hdr[19] << 8) | (hdr[20] << 16) | (static_cast<DWORD>(hdr[21]) << 24);
+			unsigned long long usize = hdr[22] | (hdr[23] << 8) | (hdr[24] << 16) | (static_cast<DWORD>(hdr[25]) << 24);
+			size_t namelen = hdr[26] | (hdr[27] << 8);
+			size_t extralen = hdr[28] | (hdr[29] << 8);
+			unsigned char extra[0x10000];
+			bool zip64 = false;
+
+			if (!reserve(namelen + 1) || !read_exact(m_buf, namelen) || !read_exact(extra, extralen)) {
+				m_error = L"unexpected end of zip archive";
+				return MEMBER_ERROR;
+			}
+
+			set_name(m_name, sizeof(m_name), m_buf, namelen);
+
+			// Zip64 extended information
+			for (size_t i = 0; i + 4 <= extralen; ) {
+				size_t id = extra[i] | (extra[i+1] << 8);
+				size_t len = extra[i+2] | (extra[i+3] << 8);
+
+				if (id == 0x0001 && len >= 16 && i + 4 + len <= extralen) {
+					const unsigned char *p = extra + i + 4;
+					usize = csize = 0;
+					for (int k = 7; k >= 0; --k) usize = (usize << 8) | p[k];
+					for (int k = 7; k >= 0; --k) csize = (csize << 8) | p[8 + k];
+					zip64 = true;
+					break;
+				}
+
+				i += 4 + len;
+			}
+
+			bool encrypted = (gpflags & 0x01) != 0;
+			bool keep = is_lnk_name(m_name);
+
+			// Sizes after the data (zip written to a pipe): stored members
+			// still have their uncompressed size, deflated ones end by themselves.
+			if ((gpflags & 0x08) != 0 && csize == 0) {
+				if (method == 0 && !encrypted) {
+					csize = usize;
+				} else if (method == 8 && !encrypted) {
+					size_t len = 0;
+					int rv = zip_inflate_stream(keep, usize, gpflags, zip64, len);
+
+					if (!keep && rv != MEMBER_ERROR) {
+						continue;
+					}
+
+					name = m_name;
+					data = (rv == MEMBER_OK) ? m_buf : NULL;
+					size = (rv == MEMBER_OK) ? len : 0;
+
+					return rv;
+				} else {
+					m_error = L"zip member sizes are stored after the data, can't read sequentially";
+					return MEMBER_ERROR;
+				}
+			}
+
+			if (!keep) {
+				if (!skip(csize) || !zip_skip_descriptor(gpflags, zip64)) {
+					m_error = L"unexpected end of zip archive";
+					return MEMBER_ERROR;
+				}
+				continue;
+			}
+
+			name = m_name;
+			data = NULL;
+			size = 0;
+
+			// 0 = stored, 8 = deflated
+			bool supported = (method == 0 || method == 8) && !encrypted;
+
+			if (!supported || (method == 0 && csize != usize) || csize > m_maxmember || usize > m_maxmember) {
+				if (!skip(csize) || !zip_skip_descriptor(gpflags, zip64)) {
+					m_error = L"unexpected end of zip archive";
+					return MEMBER_ERROR;
+				}
+				return supported ? MEMBER_TOO_LARGE : MEMBER_UNSUPPORTED;
+			}
+
+			// deflated data is read behind the space for the uncompressed data
+			size_t uoff = (method == 8) ? static_cast<size_t>(usize) : 0;
+
+			if (!reserve(uoff + static_cast<size_t>(csize) + 1) ||
+				!read_exact(m_buf + uoff, static_cast<size_t>(csize)) ||
+				!zip_skip_descriptor(gpflags, zip64))
+			{
+				m_error = L"unexpected end of zip archive";
+				return MEMBER_ERROR;
+			}
+
+			if (method == 8) {
+				raw_inflater z(m_buf + uoff, static_cast<size_t>(csize));
+
+				if (!z.run(m_buf, uoff) || z.size() != uoff) {
+					return MEMBER_CORRUPT;
+				}
+			}
+
+			data = m_buf;
+			size = static_cast<size_t>(usize);
+
+			return MEMBER_OK;
+		}
+	}
+
+	int next_raw(const char *&name, const unsigned char *&data, size_t &size)
+	{
+		size_t len = 0;
+
+		m_format = FORMAT_UNKNOWN;  // only one member
+		set_name(m_name, sizeof(m_name), "-", 1);
+		name = m_name;
+		data = NULL;
+		size = 0;
+
+		for (;;) {
+			if (len == m_bufsize && !reserve(m_bufsize ? m_bufsize * 2 : 4096)) {
+				m_error = L"out of memory";
+				return MEMBER_ERROR;
+			}
+
+			size_t r = read(m_buf + len, m_bufsize - len);
+
+			if (r == 0) {
+				break;
+			}
+
+			len += r;
+
+			if (len > m_maxmember) {
+				return MEMBER_TOO_LARGE;
+			}
+		}
+
+		data = m_buf;
+		size = len;
+
+		return MEMBER_OK;
+	}
+
+
+public:
+
+	archive_reader(size_t maxmember = 1024*1024)
+	: m_maxmember(maxmember)
+	{}
+
+	~archive_reader() {
+		free(m_buf);
+	}
+
+	// Detect the input format; fp must be opened in binary mode.
+	bool open(FILE *fp)
+	{
+		m_fp = fp;
+		m_error = NULL;
+		m_peekpos = 0;
+		m_peeklen = fread(m_peek, 1, sizeof(m_peek), fp);
+
+		if (m_peeklen >= 4 && memcmp(m_peek, "PK\x03\x04", 4) == 0) {
+			m_format = FORMAT_ZIP;
+		} else if (m_peeklen == 512 && tar_checksum_ok(m_peek)) {
+			m_format = FORMAT_TAR;
+		} else if (m_peeklen >= sizeof(lnk_signature) &&
+					memcmp(m_peek, lnk_signature, sizeof(lnk_signature)) == 0)
+		{
+			m_format = FORMAT_RAW;
+		} else {
+			m_format = FORMAT_UNKNOWN;
+			m_error = L"input is neither a tar or zip archive nor a Shell Link";
+			return false;
+		}
+
+		return true;
+	}
+
+	int format() const {
+		return m_format;
+	}
+
+	// error message after open() returned false or next() returned MEMBER_ERROR
+	const wchar_t *error() const {
+		return m_error ? m_error : L"unknown error";
+	}
+
+	// Advance to the next .lnk member. name/data stay valid until the next call;
+	// data is only set if MEMBER_OK is returned.
+	int next(const char *&name, const unsigned char *&data, size_t &size)
+	{
+		switch (m_format)
+		{
+		case FORMAT_RAW:
+			return next_raw(name, data, size);
+		case FORMAT_TAR:
+			return next_tar(name, data, size);
+		case FORMAT_ZIP:
+			return next_zip(name, data, size);
+		default:
+			break;
+		}
+
+		return MEMBER_END;
+	}
+};
@@ -0,0 +1,477 @@
+/*
+Licensed under the MIT License <http://opensource.org/licenses/MIT>.
+SPDX-License-Identifier: MIT
+Copyright (c) 2020-2026 djcj@gmx.de
+
+Permission is hereby  granted, free of charge, to any  person obtaining a copy
+of this software and associated  documentation files (the "Software"), to deal
+in the Software  without restriction, including without  limitation the rights
+to  use, copy,  modify, merge,  publish, distribute,  sublicense, and/or  sell
+copies  of  the Software,  and  to  permit persons  to  whom  the Software  is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE  IS PROVIDED "AS  IS", WITHOUT WARRANTY  OF ANY KIND,  EXPRESS OR
+IMPLIED,  INCLUDING BUT  NOT  LIMITED TO  THE  WARRANTIES OF  MERCHANTABILITY,
+FITNESS FOR  A PARTICULAR PURPOSE AND  NONINFRINGEMENT. IN NO EVENT  SHALL THE
+AUTHORS  OR COPYRIGHT  HOLDERS  BE  LIABLE FOR  ANY  CLAIM,  DAMAGES OR  OTHER
+LIABILITY, WHETHER IN AN ACTION OF  CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE  OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/**
+ * Read tab separated provisioning manifests for mkshortcut.
+ *
+ * The manifest is memory mapped and split into rows and columns in place.
+ * Fields are interned in a string_pool (one per column), so repeated values
+ * (icons, working directories, targets) are stored once and converted into a
+ * wide string only once, the first time they are used. The pools keep the
+ * bytes of distinct values close together, which makes lookups much faster
+ * than comparing against first occurrences all over the mapping. Output paths
+ * are unique anyway and are converted straight from the mapping instead.
+ * Rows are read one at a time, memory use depends on the number of distinct
+ * values only.
+ *
+ * Manifests can be UTF-8 (default) or UTF-16 with byte order mark. Empty
+ * lines and lines starting with '#' are ignored.
+ */
+
+#pragma once
+
+#include <vector>
+#include "compat.hpp"
+
+
+enum manifest_encoding {
+	MANIFEST_UTF8 = 0,
+	MANIFEST_UTF16LE,
+	MANIFEST_UTF16BE
+};
+
+// number of wide characters needed to decode len bytes (including the NUL)
+inline size_t manifest_decoded_size(int enc, size_t len)
+{
+	return ((enc == MANIFEST_UTF8) ? len : len / 2) + 1;
+}
+
+// decode len bytes into out; swap is scratch space for big endian input
+inline void manifest_decode(int enc, const unsigned char *p, size_t len, wchar_t *out, size_t outlen,
+							std::vector<unsigned char> &swap)
+{
+	if (enc == MANIFEST_UTF8) {
+		compat_utf8_to_wide(reinterpret_cast<const char *>(p), len, out, outlen);
+	} else if (enc == MANIFEST_UTF16LE) {
+		compat_utf16le_to_wide(p, len / 2, out, outlen);
+	} else {
+		swap.resize(len);
+
+		for (size_t i = 0; i + 1 < len; i += 2) {
+			swap[i] = p[i + 1];
+			swap[i + 1] = p[i];
+		}
+
+		compat_utf16le_to_wide(swap.data(), len / 2, out, outlen);
+	}
+}
+
+
+// Hash-consed strings in the manifest encoding; id 0 is the empty string.
+class string_pool
+{
+private:
+
+	struct entry
+	{
+		size_t off;              // position in m_bytes
+		size_t len;              // length in bytes
+		const wchar_t *wide;     // NULL until first requested
+	};
+
+	// lookups only touch the table and the string bytes
+	struct slot
+	{
+		size_t off;
+		size_t len;
+		unsigned hash;
+		unsigned id;             // 0 = free
+	};
+
+	enum { BLOCK = 64*1024 };    // arena block size in wchar_t
+
+	int m_enc = MANIFEST_UTF8;
+	std::vector<unsigned char> m_bytes;   // the distinct strings, back to back
+	std::vector<entry> m_entries;
+	std::vector<slot> m_table;            // open addressing, at most half full
+	std::vector<wchar_t *> m_blocks;
+	size_t m_blockfree = 0;
+	std::vector<unsigned char> m_swap;
+
+
+	static unsigned hash_bytes(const unsigned char *p, size_t len)
+	{
+		unsigned long long h = 0x9e3779b97f4a7c15ULL ^ len;
+
+		for ( ; len >= 8; p += 8, len -= 8) {
+			unsigned long long w;
+			memcpy(&w, p, 8);
+			h = (h ^ w) * 0xff51afd7ed558ccdULL;
+			h ^= h >> 32;
+		}
+
+		for ( ; len > 0; ++p, --len) {
+			h = (h ^ *p) * 0x100000001b3ULL;
+		}
+
+		h ^= h >> 33;
+		h *= 0xc4ceb9fe1a85ec53ULL;
+		h ^= h >> 29;
+
+		return static_cast<unsigned>(h);
+	}
+
+	void grow()
+	{
+		std::vector<slot> table(m_table.empty() ? 1024 : m_table.size() * 2, slot{0, 0, 0, 0});
+		size_t mask = table.size() - 1;
+
+		for (size_t n = 0; n < m_table.size(); ++n) {
+			if (m_table[n].id == 0) {
+				continue;
+			}
+
+			size_t i = m_table[n].hash & mask;
+
+			while (table[i].id != 0) {
+				i = (i + 1) & mask;
+			}
+
+			table[i] = m_table[n];
+		}
+
+		m_table.swap(table);
+	}
+
+	// room for n wide characters that stays valid until clear()
+	wchar_t *alloc(size_t n)
+	{
+		if (n > BLOCK) {
+			// large strings get their own block, the current one stays in use
+			wchar_t *p = new wchar_t[n];
+			m_blocks.insert(m_blocks.end() - (m_blocks.empty() ? 0 : 1), p);
+			return p;
+		}
+
+		if (m_blocks.empty() || m_blockfree < n) {
+			m_blocks.push_back(new wchar_t[BLOCK]);
+			m_blockfree = BLOCK;
+		}
+
+		m_blockfree -= n;
+
+		return m_blocks.back() + (BLOCK - m_blockfree - n);
+	}
+
+
+public:
+
+	string_pool()
+	{
+		clear();
+	}
+
+	~string_pool() {
+		clear();
+	}
+
+	void reset(int enc)
+	{
+		clear();
+		m_enc = enc;
+	}
+
+	void clear()
+	{
+		for (size_t i = 0; i < m_blocks.size(); ++i) {
+			delete[] m_blocks[i];
+		}
+
+		m_blocks.clear();
+		m_blockfree = 0;
+		m_entries.assign(1, entry{0, 0, NULL});
+		m_table.clear();
+		m_bytes.clear();
+	}
+
+	// id of the len bytes at p, added if they weren't seen before
+	unsigned intern(const unsigned char *p, size_t len)
+	{
+		if (len == 0) {
+			return 0;
+		}
+
+		if (m_entries.size() * 2 >= m_table.size()) {
+			grow();
+		}
+
+		unsigned hash = hash_bytes(p, len);
+		size_t mask = m_table.size() - 1;
+		size_t i = hash & mask;
+
+		for ( ; m_table[i].id != 0; i = (i + 1) & mask) {
+			const slot &s = m_table[i];
+
+			if (s.hash == hash && s.len == len && memcmp(m_bytes.data() + s.off, p, len) == 0) {
+				return s.id;
+			}
+		}
+
+		unsigned id = static_cast<unsigned>(m_entries.size());
+
+		m_table[i] = slot{m_bytes.size(), len, hash, id};
+		m_entries.push_back(entry{m_bytes.size(), len, NULL});
+		m_bytes.insert(m_bytes.end(), p, p + len);
+
+		return id;
+	}
+
+	// wide string for id, NULL for id 0
+	const wchar_t *get(unsigned id)
+	{
+		if (id == 0 || id >= m_entries.size()) {
+			return NULL;
+		}
+
+		entry &e = m_entries[id];
+
+		if (!e.wide) {
+			size_t outlen = manifest_decoded_size(m_enc, e.len);
+			wchar_t *out = alloc(outlen);
+
+			manifest_decode(m_enc, m_bytes.data() + e.off, e.len, out, outlen, m_swap);
+			e.wide = out;
+		}
+
+		return e.wide;
+	}
+
+	// number of distinct strings
+	size_t size() const {
+		return m_entries.size() - 1;
+	}
+};
+
+
+class manifest_reader
+{
+public:
+
+	// columns, in the order of the mkshortcut options
+	enum {
+		COL_OUTPUT = 0,   // /o
+		COL_TARGET,       // /t
+		COL_ARGS,         // /a
+		COL_ICON,         // /i
+		COL_ICONIDX,      // /n
+		COL_DESC,         // /d
+		COL_WDIR,         // /w
+		COL_HOTKEY,       // /k
+		COL_WINDOW,       // normal, max or min
+		COL_ADMIN,        // yes or no
+		COLUMNS
+	};
+
+	enum {
+		ROW_ERROR = -1,   // more than COLUMNS columns
+		ROW_END = 0,
+		ROW_OK
+	};
+
+
+private:
+
+	compat_mapped_file m_file;
+	string_pool m_pools[COLUMNS];   // one per column, COL_OUTPUT is not interned
+	const unsigned char *m_data = NULL;
+	int m_enc = MANIFEST_UTF8;
+	size_t m_unit = 1;       // bytes per code unit
+	size_t m_pos = 0;
+	size_t m_end = 0;
+	size_t m_line = 0;
+	size_t m_output = 0;     // COL_OUTPUT of the current row in the mapping
+	size_t m_outputlen = 0;
+	std::vector<wchar_t> m_outbuf;
+	std::vector<unsigned char> m_swap;
+
+
+	unsigned unit_at(size_t off) const
+	{
+		switch (m_enc)
+		{
+		case MANIFEST_UTF16LE:
+			return m_data[off] | (m_data[off + 1] << 8);
+		case MANIFEST_UTF16BE:
+			return (m_data[off] << 8) | m_data[off + 1];
+		default:
+			return m_data[off];
+		}
+	}
+
+	// offset of the first code unit c in [off, end), or end
+	size_t find(size_t off, size_t end, unsigned c) const
+	{
+		if (m_enc == MANIFEST_UTF8) {
+			const void *p = memchr(m_data + off, static_cast<int>(c), end - off);
+			return p ? static_cast<size_t>(static_cast<const unsigned char *>(p) - m_data) : end;
+		}
+
+		for ( ; off < end; off += 2) {
+			if (unit_at(off) == c) return off;
+		}
+
+		return end;
+	}
+
+
+public:
+
+	bool open(const wchar_t *path)
+	{
+		size_t bom = 0;
+
+		if (!m_file.open(path)) {
+			return false;
+		}
+
+		m_data = m_file.data();
+		m_end = static_cast<size_t>(m_file.size());
+		m_enc = MANIFEST_UTF8;
+		m_unit = 1;
+		m_line = 0;
+		m_file.advise_sequential();
+
+		if (m_end >= 3 && memcmp(m_data, "\xEF\xBB\xBF", 3) == 0) {
+			bom = 3;
+		} else if (m_end >= 2 && m_data[0] == 0xFF && m_data[1] == 0xFE) {
+			m_enc = MANIFEST_UTF16LE;
+			bom = 2;
+		} else if (m_end >= 2 && m_data[0] == 0xFE && m_data[1] == 0xFF) {
+			m_enc = MANIFEST_UTF16BE;
+			bom = 2;
+		}
+
+		if (m_enc != MANIFEST_UTF8) {
+			m_unit = 2;
+			m_end -= (m_end - bom) % 2;
+		}
+
+		m_pos = bom;
+
+		for (size_t i = 0; i < COLUMNS; ++i) {
+			m_pools[i].reset(m_enc);
+		}
+
+		return true;
+	}
+
+	// Split the next row into string ids (0 for empty or missing columns,
+	// ids are per column); returns one of the ROW_* values.
+	int next(unsigned (&cols)[COLUMNS])
+	{
+		for (;;) {
+			if (m_pos >= m_end) {
+				return ROW_END;
+			}
+
+			size_t start = m_pos;
+			size_t end = find(m_pos, m_end, '\n');
+
+			m_pos = (end < m_end) ? end + m_unit : m_end;
+			++m_line;
+
+			if (end > start && unit_at(end - m_unit) == '\r') {
+				end -= m_unit;
+			}
+
+			if (end == start || unit_at(start) == '#') {
+				continue;
+			}
+
+			// split first, a rejected row must not add to the pools
+			size_t fields[COLUMNS + 1];
+			size_t ncols = 0;
+
+			for (size_t pos = start; ; pos += m_unit) {
+				if (ncols == COLUMNS) {
+					return ROW_ERROR;
+				}
+
+				fields[ncols++] = pos;
+				pos = find(pos, end, '\t');
+
+				if (pos == end) {
+					break;
+				}
+			}
+
+			fields[ncols] = end + m_unit;
+
+			for (size_t col = 0; col < COLUMNS; ++col) {
+				cols[col] = 0;
+
+				if (col >= ncols) {
+					continue;
+				}
+
+				size_t len = fields[col+1] - m_unit - fields[col];
+
+				if (col == COL_OUTPUT) {
+					m_output = fields[col];
+					m_outputlen = len;
+					cols[col] = (len > 0) ? 1 : 0;
+				} else {
+					cols[col] = m_pools[col].intern(m_data + fields[col], len);
+				}
+			}
+
+			return ROW_OK;
+		}
+	}
+
+	// Wide string for the value id of column col, NULL if it is empty; the
+	// COL_OUTPUT string is only valid until the next row is read.
+	const wchar_t *get(size_t col, unsigned id)
+	{
+		if (col != COL_OUTPUT) {
+			return m_pools[col].get(id);
+		}
+
+		if (id == 0) {
+			return NULL;
+		}
+
+		m_outbuf.resize(manifest_decoded_size(m_enc, m_outputlen));
+		manifest_decode(m_enc, m_data + m_output, m_outputlen, m_outbuf.data(), m_outbuf.size(), m_swap);
+
+		return m_outbuf.data();
+	}
+
+	// line number of the last row returned by next()
+	size_t line() const {
+		return m_line;
+	}
+
+	// number of distinct values seen so far (without output paths)
+	size_t distinct() const
+	{
+		size_t n = 0;
+
+		for (size_t i = 0; i < COLUMNS; ++i) {
+			n += m_pools[i].size();
+		}
+
+		return n;
+	}
+};
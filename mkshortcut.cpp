@@ -30,27 +30,236 @@ SOFTWARE.
  *
  * Compile with MSVC:
  *   cl.exe -W3 -O2 -D_UNICODE -DUNICODE mkshortcut.cpp
+ *
+ * Compile natively on other systems (only /patch is available there):
+ *   g++ -Wall -Wextra -O3 -o mkshortcut mkshortcut.cpp
  */
 
 #ifdef _MSC_VER
 # define _CRT_SECURE_NO_WARNINGS
 # pragma comment(lib, "ole32.lib")
 #endif
-#include <windows.h>
-#include <objbase.h>
-#include <shlobj.h>
-#include <stdio.h>
-#include <stdlib.h>
-#include <wchar.h>
+#include <vector>
+#include "compat.hpp"
+#include "lnkpatch.hpp"
+#include "manifest.hpp"
 #include "mkshortcut.hpp"
 
 
+// patch all shortcuts given with /o and listed in the /f file
+static int patch_links(const wchar_t *prog, const shell_link_patch &patch,
+						const std::vector<const wchar_t *> &files, const wchar_t *listfile)
+{
+	int ret = 0;
+	size_t count = 0;
+
+	if (patch.empty()) {
+		wprintf_s(L"%ls: nothing to patch; use /k, /max, /min, /normal, /admin or /noadmin\n", prog);
+		return 1;
+	}
+
+	for (size_t i = 0; i < files.size(); ++i, ++count) {
+		int rv = patch.apply(files[i]);
+
+		if (rv == shell_link_patch::PATCH_ERROR) {
+			wprintf_s(L"%ls: failed to patch shortcut: %ls\n", prog, files[i]);
+			ret = 1;
+		} else {
+			wprintf_s(L"%ls: %ls\n", (rv == shell_link_patch::PATCH_OK) ? L"Patched" : L"Unchanged", files[i]);
+		}
+	}
+
+	if (listfile) {
+		FILE *fp = stdin;
+		char line[4096];
+		wchar_t path[4096];
+
+		if (wcscmp(listfile, L"-") != 0 && (fp = compat_wfopen(listfile, L"rb")) == NULL) {
+			wprintf_s(L"%ls: failed to open file: %ls\n", prog, listfile);
+			return 1;
+		}
+
+		while (fgets(line, sizeof(line), fp)) {
+			size_t len = strcspn(line, "\r\n");
+
+			if (len == 0) {
+				continue;
+			}
+
+			compat_utf8_to_wide(line, len, path, _countof(path));
+
+			int rv = patch.apply(path);
+			++count;
+
+			if (rv == shell_link_patch::PATCH_ERROR) {
+				wprintf_s(L"%ls: failed to patch shortcut: %ls\n", prog, path);
+				ret = 1;
+			} else {
+				wprintf_s(L"%ls: %ls\n", (rv == shell_link_patch::PATCH_OK) ? L"Patched" : L"Unchanged", path);
+			}
+		}
+
+		if (fp != stdin) {
+			fclose(fp);
+		}
+	}
+
+	if (count == 0) {
+		wprintf_s(L"%ls: no output given\n"
+					"Try '%ls /?' for more information.\n", prog, prog);
+		return 1;
+	}
+
+	return ret;
+}
+
+
+#ifdef _WIN32
+// create the shortcut for one manifest row; shlnk is reused so that COM is
+// only initialized once
+static bool create_row(const wchar_t *prog, shell_link &shlnk, manifest_reader &m, const unsigned *cols,
+						int showcmd, bool admin, bool reproducible, bool tFull, bool iFull)
+{
+	const wchar_t *output = m.get(manifest_reader::COL_OUTPUT, cols[manifest_reader::COL_OUTPUT]);
+	const wchar_t *target = m.get(manifest_reader::COL_TARGET, cols[manifest_reader::COL_TARGET]);
+	const wchar_t *icon = m.get(manifest_reader::COL_ICON, cols[manifest_reader::COL_ICON]);
+	const wchar_t *p = NULL;
+	wchar_t *fullPathTarget = NULL;
+	wchar_t *fullPathIcon = NULL;
+	unsigned long long line = m.line();
+	bool ok = false;
+
+	if (!output || !target) {
+		wprintf_s(L"%ls: line %llu: output and target are required\n", prog, line);
+		return false;
+	}
+
+	shlnk.reset();
+	shlnk.filename(output);
+	shlnk.linktarget(target);
+	shlnk.iconpath(icon);
+	shlnk.args(m.get(manifest_reader::COL_ARGS, cols[manifest_reader::COL_ARGS]));
+	shlnk.description(m.get(manifest_reader::COL_DESC, cols[manifest_reader::COL_DESC]));
+	shlnk.workingdir(m.get(manifest_reader::COL_WDIR, cols[manifest_reader::COL_WDIR]));
+	shlnk.reproducible(reproducible);
+
+	if ((p = m.get(manifest_reader::COL_ICONIDX, cols[manifest_reader::COL_ICONIDX])) != NULL &&
+		!shlnk.iconidx(p))
+	{
+		wprintf_s(L"%ls: line %llu: invalid icon index: %ls\n", prog, line, p);
+		return false;
+	}
+
+	if ((p = m.get(manifest_reader::COL_HOTKEY, cols[manifest_reader::COL_HOTKEY])) != NULL &&
+		!shlnk.hotkey(p))
+	{
+		wprintf_s(L"%ls: line %llu: invalid hotkey: %ls\n", prog, line, p);
+		return false;
+	}
+
+	// window and admin columns override the command line
+	if ((p = m.get(manifest_reader::COL_WINDOW, cols[manifest_reader::COL_WINDOW])) != NULL) {
+		if (_wcsicmp(p, L"normal") == 0) {
+			showcmd = SW_SHOWNORMAL;
+		} else if (_wcsicmp(p, L"max") == 0) {
+			showcmd = SW_SHOWMAXIMIZED;
+		} else if (_wcsicmp(p, L"min") == 0) {
+			showcmd = SW_SHOWMINNOACTIVE;
+		} else {
+			wprintf_s(L"%ls: line %llu: invalid window setting: %ls\n", prog, line, p);
+			return false;
+		}
+	}
+
+	if ((p = m.get(manifest_reader::COL_ADMIN, cols[manifest_reader::COL_ADMIN])) != NULL) {
+		if (_wcsicmp(p, L"yes") == 0) {
+			admin = true;
+		} else if (_wcsicmp(p, L"no") == 0) {
+			admin = false;
+		} else {
+			wprintf_s(L"%ls: line %llu: invalid admin setting: %ls\n", prog, line, p);
+			return false;
+		}
+	}
+
+	shlnk.showcmd(showcmd);
+	shlnk.admin(admin);
+
+	// make full paths
+	if (tFull) {
+		if ((fullPathTarget = _wfullpath(NULL, target, 0)) == NULL) {
+			wprintf_s(L"%ls: line %llu: failed to resolve full path: %ls\n", prog, line, target);
+			return false;
+		}
+		shlnk.linktarget(fullPathTarget);
+	}
+
+	if (iFull && icon) {
+		if ((fullPathIcon = _wfullpath(NULL, icon, 0)) == NULL) {
+			wprintf_s(L"%ls: line %llu: failed to resolve full path: %ls\n", prog, line, icon);
+			free(fullPathTarget);
+			return false;
+		}
+		shlnk.iconpath(fullPathIcon);
+	}
+
+	if (shlnk.create()) {
+		ok = true;
+	} else {
+		wprintf_s(L"%ls: line %llu: failed to create shortcut: %ls\n", prog, line, output);
+	}
+
+	free(fullPathIcon);
+	free(fullPathTarget);
+
+	return ok;
+}
+
+
+// create one shortcut per row of a manifest (see manifest.hpp)
+static int create_from_manifest(const wchar_t *prog, const wchar_t *path, int showcmd, bool admin,
+								bool reproducible, bool tFull, bool iFull)
+{
+	manifest_reader *m = new manifest_reader;
+	shell_link shlnk;
+	unsigned cols[manifest_reader::COLUMNS];
+	unsigned long long created = 0;
+	int ret = 0;
+	int rv;
+
+	if (!m->open(path)) {
+		wprintf_s(L"%ls: failed to open file: %ls\n", prog, path);
+		delete m;
+		return 1;
+	}
+
+	while ((rv = m->next(cols)) != manifest_reader::ROW_END) {
+		if (rv == manifest_reader::ROW_ERROR) {
+			wprintf_s(L"%ls: line %llu: too many columns\n", prog,
+						static_cast<unsigned long long>(m->line()));
+			ret = 1;
+		} else if (create_row(prog, shlnk, *m, cols, showcmd, admin, reproducible, tFull, iFull)) {
+			++created;
+		} else {
+			ret = 1;
+		}
+	}
+
+	wprintf_s(L"%llu shortcut(s) created\n", created);
+
+	delete m;
+
+	return ret;
+}
+#endif // _WIN32
+
+
 int wmain(int argc, wchar_t *argv[])
 {
 	const wchar_t *help_text = L""
 		"Create a Shell Link a.k.a. Shortcut\n"
 		"\n"
-		"Usage: %s [options]\n"
+		"Usage: %ls [options]\n"
 		"\n"
 		"  Options can begin with '/' or '-' and are case-insensitive,\n"
 		"  argument separator can be ':' or '='\n"
@@ -70,26 +279,53 @@ int wmain(int argc, wchar_t *argv[])
 		"                      A-Z, F1-F24, NUMLOCK or SCROLL)\n"
 		"  /max                Start with maximized window\n"
 		"  /min                Start with minimized window\n"
+		"  /normal             Start with normal window (default)\n"
 		"  /tfull              Resolve path to shortcut target to a full path\n"
 		"  /ifull              Resolve path to icon file to a full path\n"
 		"  /admin              Flag shortcut to be run as Administrator\n"
+		"  /noadmin            Don't run shortcut as Administrator (default)\n"
+		"  /reproducible       Write identical bytes for identical options: zero\n"
+		"                      timestamps and volume serial number and label, drop\n"
+		"                      machine specific tracking data and sort extra data\n"
+		"                      blocks\n"
+		"\n"
+		"  /patch              Change hotkey, window setting and/or Administrator flag\n"
+		"                      of existing shortcuts in place instead of creating one;\n"
+		"                      /o can be given multiple times, /k:none removes the hotkey\n"
+		"  /f:<file>           With /patch: read paths to shortcuts from file, one per\n"
+		"                      line ('-' reads from stdin)\n"
+		"\n"
+		"  /m:<manifest>       Create one shortcut per line of a tab separated file\n"
+		"                      (UTF-8 or UTF-16 with BOM) with the columns: output,\n"
+		"                      target, arguments, icon, icon index, description,\n"
+		"                      working directory, hotkey, window (normal, max or min)\n"
+		"                      and admin (yes or no); empty columns are not set,\n"
+		"                      lines starting with '#' are ignored. /tfull, /ifull\n"
+		"                      and /reproducible apply to all lines, /max, /min,\n"
+		"                      /normal, /admin and /noadmin to lines that leave\n"
+		"                      the window or admin column empty\n"
 		"\n";
 
 	const wchar_t *invOptMsg = L""
-		"%s: invalid option -- '%s'\n"
-		"Try '%s /?' for more information.\n";
+		"%ls: invalid option -- '%ls'\n"
+		"Try '%ls /?' for more information.\n";
 
 	shell_link shlnk;
-	const wchar_t *p = NULL;
+	shell_link_patch patch;
+	std::vector<const wchar_t *> files;
+	const wchar_t *listFile = NULL;
+	const wchar_t *manifestFile = NULL;
 	const wchar_t *prog = argv[0];
 	const wchar_t *pszFileName = NULL;
 	const wchar_t *pszLinkTarget = NULL;
 	const wchar_t *pszIconPath = NULL;
-	wchar_t *fullPathTarget = NULL;
-	wchar_t *fullPathIcon = NULL;
-	int ret = 0;
 	bool tFull = false;
 	bool iFull = false;
+	bool patchMode = false;
+	bool reproducible = false;
+	bool runAsAdmin = false;
+	int showCmd = SW_SHOWNORMAL;
+	WORD wHotkey = 0;
 
 	if (argc < 2) {
 		wprintf_s(help_text, prog);
@@ -119,10 +355,19 @@ int wmain(int argc, wchar_t *argv[])
 		}
 
 		if (_wcsicmp(a+1, L"max") == 0) {
+			showCmd = SW_SHOWMAXIMIZED;
 			shlnk.showcmd(SW_SHOWMAXIMIZED);
+			patch.showcmd(SW_SHOWMAXIMIZED);
 			continue;
 		} else if (_wcsicmp(a+1, L"min") == 0) {
+			showCmd = SW_SHOWMINNOACTIVE;
 			shlnk.showcmd(SW_SHOWMINNOACTIVE);
+			patch.showcmd(SW_SHOWMINNOACTIVE);
+			continue;
+		} else if (_wcsicmp(a+1, L"normal") == 0) {
+			showCmd = SW_SHOWNORMAL;
+			shlnk.showcmd(SW_SHOWNORMAL);
+			patch.showcmd(SW_SHOWNORMAL);
 			continue;
 		} else if (_wcsicmp(a+1, L"tfull") == 0) {
 			tFull = true;
@@ -131,7 +376,21 @@ int wmain(int argc, wchar_t *argv[])
 			iFull = true;
 			continue;
 		} else if (_wcsicmp(a+1, L"admin") == 0) {
+			runAsAdmin = true;
 			shlnk.admin(true);
+			patch.admin(true);
+			continue;
+		} else if (_wcsicmp(a+1, L"noadmin") == 0) {
+			runAsAdmin = false;
+			shlnk.admin(false);
+			patch.admin(false);
+			continue;
+		} else if (_wcsicmp(a+1, L"reproducible") == 0) {
+			reproducible = true;
+			shlnk.reproducible(true);
+			continue;
+		} else if (_wcsicmp(a+1, L"patch") == 0) {
+			patchMode = true;
 			continue;
 		}
 
@@ -145,6 +404,7 @@ int wmain(int argc, wchar_t *argv[])
 			case L'o':
 				pszFileName = a+3;
 				shlnk.filename(pszFileName);
+				files.push_back(pszFileName);
 				break;
 			case L't':
 				pszLinkTarget = a+3;
@@ -168,10 +428,18 @@ int wmain(int argc, wchar_t *argv[])
 				shlnk.workingdir(a+3);
 				break;
 			case L'k':
-				if (!shlnk.hotkey(a+3)) {
+				if (!parse_hotkey(a+3, wHotkey)) {
 					wprintf_s(invOptMsg, prog, a, prog);
 					return 1;
 				}
+				shlnk.hotkey(a+3);
+				patch.hotkey(wHotkey);
+				break;
+			case L'f':
+				listFile = a+3;
+				break;
+			case L'm':
+				manifestFile = a+3;
 				break;
 			default:
 				wprintf_s(invOptMsg, prog, a, prog);
@@ -179,17 +447,44 @@ int wmain(int argc, wchar_t *argv[])
 		}
 	}
 
+	if (patchMode) {
+		return patch_links(prog, patch, files, listFile);
+	}
+
+#ifndef _WIN32
+	// the remaining options are only used to create shortcuts
+	(void)pszLinkTarget;
+	(void)pszIconPath;
+	(void)tFull;
+	(void)iFull;
+	(void)manifestFile;
+	(void)reproducible;
+	(void)runAsAdmin;
+	(void)showCmd;
+
+	wprintf_s(L"%ls: creating shortcuts is only supported on Windows, use /patch\n", prog);
+	return 1;
+#else
+	const wchar_t *p = NULL;
+	wchar_t *fullPathTarget = NULL;
+	wchar_t *fullPathIcon = NULL;
+	int ret = 0;
+
+	if (manifestFile) {
+		return create_from_manifest(prog, manifestFile, showCmd, runAsAdmin, reproducible, tFull, iFull);
+	}
+
 	// check if filename was set
 	if (!pszFileName) {
-		wprintf_s(L"%s: no output given\n"
-					"Try '%s /?' for more information.\n", prog, prog);
+		wprintf_s(L"%ls: no output given\n"
+					"Try '%ls /?' for more information.\n", prog, prog);
 		return 1;
 	}
 
 	// check if link target was set
 	if (!pszLinkTarget) {
-		wprintf_s(L"%s: no target given\n"
-					"Try '%s /?' for more information.\n", prog, prog);
+		wprintf_s(L"%ls: no target given\n"
+					"Try '%ls /?' for more information.\n", prog, prog);
 		return 1;
 	}
 
@@ -208,7 +503,7 @@ int wmain(int argc, wchar_t *argv[])
 		if (fullPathTarget) {
 			shlnk.linktarget(fullPathTarget);
 		} else {
-			wprintf_s(L"%s: failed to resolve full path: %s\n", prog, pszLinkTarget);
+			wprintf_s(L"%ls: failed to resolve full path: %ls\n", prog, pszLinkTarget);
 			ret = 1;
 		}
 	}
@@ -219,7 +514,7 @@ int wmain(int argc, wchar_t *argv[])
 		if (fullPathIcon) {
 			shlnk.iconpath(fullPathIcon);
 		} else {
-			wprintf_s(L"%s: failed to resolve full path: %s\n", prog, pszIconPath);
+			wprintf_s(L"%ls: failed to resolve full path: %ls\n", prog, pszIconPath);
 			ret = 1;
 		}
 	}
@@ -228,10 +523,10 @@ int wmain(int argc, wchar_t *argv[])
 	if (ret == 0) {
 		if (shlnk.create()) {
 			wchar_t *buf = _wfullpath(NULL, pszFileName, 0);
-			wprintf_s(L"Shortcut created:\n%s\n", buf ? buf : pszFileName);
+			wprintf_s(L"Shortcut created:\n%ls\n", buf ? buf : pszFileName);
 			free(buf);
 		} else {
-			wprintf_s(L"%s: failed to create shortcut\n", prog);
+			wprintf_s(L"%ls: failed to create shortcut\n", prog);
 
 			if (!tFull) {
 				wprintf_s(L"try to use /tfull to resolve target path\n");
@@ -245,4 +540,12 @@ int wmain(int argc, wchar_t *argv[])
 	free(fullPathTarget);
 
 	return ret;
+#endif // _WIN32
 }
+
+#ifndef _WIN32
+int main(int argc, char *argv[])
+{
+	return compat_main(argc, argv, wmain);
+}
+#endif
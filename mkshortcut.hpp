@@ -24,12 +24,78 @@ SOFTWARE.
 
 #pragma once
 
-#include <windows.h>
-#include <objbase.h>
-#include <shlobj.h>
+#include "compat.hpp"
+#ifdef _WIN32
+# include <objbase.h>
+# include <shlobj.h>
+#endif
 #include <stdio.h>
 #include <stdlib.h>
 #include <wchar.h>
+#include <vector>
+#include "lnkcanon.hpp"
+
+
+// Parse a hotkey string like "cak", "csf12" or "sanumlock" (see /k option);
+// "none" yields 0 (no hotkey).
+// HighByte modifier flags: HOTKEYF_ALT, HOTKEYF_CONTROL, HOTKEYF_EXT, HOTKEYF_SHIFT
+// LowByte key values: 0-9, A-Z, VK_F1-VK_F24, VK_NUMLOCK, VK_SCROLL
+// see part 2.1.3 of Shell Link specs: https://learn.microsoft.com/en-us/openspecs/windows_protocols/ms-shllink
+inline bool parse_hotkey(const wchar_t *p, WORD &wHotkey)
+{
+	WORD combo;
+	int f = 0;
+
+	if (p && _wcsicmp(p, L"none") == 0) {
+		wHotkey = 0;
+		return true;
+	}
+
+	if (!p || wcslen(p) < 3) {
+		return false;
+	}
+
+	if (_wcsnicmp(p, L"ca", 2) == 0) {
+		combo = HOTKEYF_CONTROL | HOTKEYF_ALT;
+	} else if (_wcsnicmp(p, L"cs", 2) == 0) {
+		combo = HOTKEYF_CONTROL | HOTKEYF_SHIFT;
+	} else if (_wcsnicmp(p, L"sa", 2) == 0) {
+		combo = HOTKEYF_SHIFT | HOTKEYF_ALT;
+	} else {
+		return false;
+	}
+
+	p += 2;
+
+	wchar_t key = towupper(p[0]);
+
+	if (wcslen(p) == 1) {
+		// A-Z, 0-9
+		if (key >= L'A' && key <= L'Z') {
+			wHotkey = (combo << 8) | ( L'A' + (key - L'A') );
+			return true;
+		} else if (key >= L'0' && key <= L'9') {
+			wHotkey = (combo << 8) | ( L'0' + (key - L'0') );
+			return true;
+		}
+	} else {
+		// Numlock, Scroll, F-keys
+		if (_wcsicmp(p, L"numlock") == 0) {
+			wHotkey = (combo << 8) | VK_NUMLOCK;
+			return true;
+		} else if (_wcsicmp(p, L"scroll") == 0) {
+			wHotkey = (combo << 8) | VK_SCROLL;
+			return true;
+		} else if (key == L'F' && swscanf_s(p+1, L"%d", &f) == 1 &&
+					f >= 1 && f <= 24)
+		{
+			wHotkey = (combo << 8) | (VK_F1 + (f - 1));
+			return true;
+		}
+	}
+
+	return false;
+}
 
 
 class shell_link
@@ -45,17 +111,15 @@ private:
 	const wchar_t *m_wdir = NULL;        // Working directory to run command
 	int m_showcmd = SW_SHOWNORMAL;       // Show window setting: SW_SHOWNORMAL, SW_SHOWMAXIMIZED or SW_SHOWMINNOACTIVE
 	bool m_admin = false;                // Flag shell link to be run as Administrator
-	HRESULT m_cominitialized = -1;       // Whether COM was initialized or not
-
-	// Sets a keyboard shortcut (hot key);
-	// HighByte modifier flags: HOTKEYF_ALT, HOTKEYF_CONTROL, HOTKEYF_EXT, HOTKEYF_SHIFT
-	// LowByte key values: 0-9, A-Z, VK_F1-VK_F24, VK_NUMLOCK, VK_SCROLL
-	// see part 2.1.3 of Shell Link specs: https://learn.microsoft.com/en-us/openspecs/windows_protocols/ms-shllink
-	WORD m_hotkey = 0;
+	WORD m_hotkey = 0;                   // Keyboard shortcut (hot key), see parse_hotkey()
+	bool m_reproducible = false;         // Write canonical bytes, see shell_link_canonicalizer
 
+#ifdef _WIN32
+	HRESULT m_cominitialized = -1;       // Whether COM was initialized or not
 	IShellLink *m_shlink = NULL;
 	IShellLinkDataList *m_shldl = NULL;
 	IPersistFile *m_pfile = NULL;
+#endif
 
 
 public:
@@ -69,18 +133,32 @@ public:
 
 	void clear()
 	{
-		if (m_shldl) m_shldl->Release();
-		if (m_pfile) m_pfile->Release();
-		if (m_shlink) m_shlink->Release();
+#ifdef _WIN32
+		release();
 
 		if (SUCCEEDED(m_cominitialized)) {
 			CoUninitialize();
 		}
 
-		m_shldl = NULL;
-		m_pfile = NULL;
-		m_shlink = NULL;
 		m_cominitialized = -1;
+#endif
+	}
+
+	// Restore the default settings to create another Shell Link; COM stays
+	// initialized until clear() is called or the object is destroyed.
+	void reset()
+	{
+		m_filename = NULL;
+		m_linktarget = NULL;
+		m_args = NULL;
+		m_iconpath = NULL;
+		m_iconidx = 0;
+		m_desc = NULL;
+		m_wdir = NULL;
+		m_showcmd = SW_SHOWNORMAL;
+		m_admin = false;
+		m_hotkey = 0;
+		m_reproducible = false;
 	}
 
 	void filename(const wchar_t *path) { m_filename = path; }
@@ -90,6 +168,7 @@ public:
 	void description(const wchar_t *str) { m_desc = str; }
 	void workingdir(const wchar_t *path) { m_wdir = path; }
 	void admin(bool b) { m_admin = b; }
+	void reproducible(bool b) { m_reproducible = b; }
 
 	bool iconidx(const wchar_t *p)
 	{
@@ -117,76 +196,32 @@ public:
 		}
 	}
 
-	bool hotkey(const wchar_t *p)
-	{
-		WORD combo;
-		int f = 0;
-
-		if (!p || wcslen(p) < 3) {
-			return false;
-		}
-
-		if (_wcsnicmp(p, L"ca", 2) == 0) {
-			combo = HOTKEYF_CONTROL | HOTKEYF_ALT;
-		} else if (_wcsnicmp(p, L"cs", 2) == 0) {
-			combo = HOTKEYF_CONTROL | HOTKEYF_SHIFT;
-		} else if (_wcsnicmp(p, L"sa", 2) == 0) {
-			combo = HOTKEYF_SHIFT | HOTKEYF_ALT;
-		} else {
-			return false;
-		}
-
-		p += 2;
-
-		wchar_t key = towupper(p[0]);
-
-		if (wcslen(p) == 1) {
-			// A-Z, 0-9
-			if (key >= L'A' && key <= L'Z') {
-				m_hotkey = (combo << 8) | ( L'A' + (key - L'A') );
-				return true;
-			} else if (key >= L'0' && key <= L'9') {
-				m_hotkey = (combo << 8) | ( L'0' + (key - L'0') );
-				return true;
-			}
-		} else {
-			// Numlock, Scroll, F-keys
-			if (_wcsicmp(p, L"numlock") == 0) {
-				m_hotkey = (combo << 8) | VK_NUMLOCK;
-				return true;
-			} else if (_wcsicmp(p, L"scroll") == 0) {
-				m_hotkey = (combo << 8) | VK_SCROLL;
-				return true;
-			} else if (key == L'F' && swscanf_s(p+1, L"%d", &f) == 1 &&
-						f >= 1 && f <= 24)
-			{
-				m_hotkey = (combo << 8) | (VK_F1 + (f - 1));
-				return true;
-			}
-		}
-
-		return false;
+	bool hotkey(const wchar_t *p) {
+		return parse_hotkey(p, m_hotkey);
 	}
 
+#ifdef _WIN32
 	bool create()
 	{
-		clear();
+		release();
 
 		// filename and link target required
 		if (!m_filename || !m_linktarget) {
 			return false;
 		}
 
-		// initialize COM library
-		const DWORD dwCoFlags =
-			COINIT_APARTMENTTHREADED |
-			COINIT_DISABLE_OLE1DDE |
-			COINIT_SPEED_OVER_MEMORY;
+		// initialize COM library, once for all Shell Links created with this object
+		if (FAILED(m_cominitialized)) {
+			const DWORD dwCoFlags =
+				COINIT_APARTMENTTHREADED |
+				COINIT_DISABLE_OLE1DDE |
+				COINIT_SPEED_OVER_MEMORY;
 
-		m_cominitialized = CoInitializeEx(NULL, dwCoFlags);
+			m_cominitialized = CoInitializeEx(NULL, dwCoFlags);
 
-		if (FAILED(m_cominitialized)) {
-			return false;
+			if (FAILED(m_cominitialized)) {
+				return false;
+			}
 		}
 
 		// create instance
@@ -231,6 +266,10 @@ public:
 			}
 		}
 
+		if (m_reproducible) {
+			return save_reproducible();
+		}
+
 		// save Shell Link file
 		if (SUCCEEDED(m_pfile->Save(m_filename, TRUE)) &&
 			SUCCEEDED(m_pfile->SaveCompleted(m_filename)))
@@ -240,4 +279,63 @@ public:
 
 		return false;
 	}
+
+private:
+
+	// release the interfaces of the last Shell Link
+	void release()
+	{
+		if (m_shldl) m_shldl->Release();
+		if (m_pfile) m_pfile->Release();
+		if (m_shlink) m_shlink->Release();
+
+		m_shldl = NULL;
+		m_pfile = NULL;
+		m_shlink = NULL;
+	}
+
+	// serialize into memory, canonicalize and write the file in one go
+	bool save_reproducible()
+	{
+		IPersistStream *pstream = NULL;
+		IStream *stream = NULL;
+		HGLOBAL hg = NULL;
+		STATSTG st;
+		bool ok = false;
+
+		if (FAILED(m_shlink->QueryInterface(IID_IPersistStream,
+											reinterpret_cast<void **>(&pstream))))
+		{
+			return false;
+		}
+
+		if (SUCCEEDED(CreateStreamOnHGlobal(NULL, TRUE, &stream)) &&
+			SUCCEEDED(pstream->Save(stream, TRUE)) &&
+			SUCCEEDED(stream->Stat(&st, STATFLAG_NONAME)) &&
+			SUCCEEDED(GetHGlobalFromStream(stream, &hg)))
+		{
+			const unsigned char *data = static_cast<const unsigned char *>(GlobalLock(hg));
+			std::vector<unsigned char> out;
+			shell_link_canonicalizer canon;
+			FILE *fp;
+
+			if (data &&
+				canon.canonicalize(data, static_cast<size_t>(st.cbSize.QuadPart), out) &&
+				(fp = compat_wfopen(m_filename, L"wb")) != NULL)
+			{
+				ok = (fwrite(&out[0], 1, out.size(), fp) == out.size());
+				ok = (fclose(fp) == 0) && ok;
+			}
+
+			if (data) {
+				GlobalUnlock(hg);
+			}
+		}
+
+		if (stream) stream->Release();
+		pstream->Release();
+
+		return ok;
+	}
+#endif // _WIN32
 };
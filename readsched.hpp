@@ -0,0 +1,336 @@
+/*
+Licensed under the MIT License <http://opensource.org/licenses/MIT>.
+SPDX-License-Identifier: MIT
+Copyright (c) 2020-2026 djcj@gmx.de
+
+Permission is hereby  granted, free of charge, to any  person obtaining a copy
+of this software and associated  documentation files (the "Software"), to deal
+in the Software  without restriction, including without  limitation the rights
+to  use, copy,  modify, merge,  publish, distribute,  sublicense, and/or  sell
+copies  of  the Software,  and  to  permit persons  to  whom  the Software  is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE  IS PROVIDED "AS  IS", WITHOUT WARRANTY  OF ANY KIND,  EXPRESS OR
+IMPLIED,  INCLUDING BUT  NOT  LIMITED TO  THE  WARRANTIES OF  MERCHANTABILITY,
+FITNESS FOR  A PARTICULAR PURPOSE AND  NONINFRINGEMENT. IN NO EVENT  SHALL THE
+AUTHORS  OR COPYRIGHT  HOLDERS  BE  LIABLE FOR  ANY  CLAIM,  DAMAGES OR  OTHER
+LIABILITY, WHETHER IN AN ACTION OF  CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE  OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/**
+ * Read many small files as fast as a cold cache allows.
+ *
+ * Opening files in directory order makes the disk seek back and forth
+ * between inode tables and data blocks. The scheduler first stats all files
+ * (in parallel), sorts them by device and inode number, which on most
+ * filesystems follows the on-disk layout, and then opens them in that order
+ * a window ahead of the readers, announcing each one with posix_fadvise() so
+ * the kernel has many sorted requests in flight. Reader threads fetch every
+ * file with a single pread() and hand it to a callback.
+ *
+ * On Windows the files are read in the given order by the reader threads.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <string>
+#include <vector>
+#include "bounded_queue.hpp"
+#include "compat.hpp"
+#include "compat_thread.hpp"
+#include "filelist.hpp"
+
+
+class read_scheduler
+{
+public:
+
+	// Called from the reader threads for every file; data is NULL if the file
+	// couldn't be read. slot (0 .. threads()-1) identifies the calling thread
+	// and can be used to keep per-thread state without locking.
+	typedef std::function<void (unsigned slot, size_t index,
+								const unsigned char *data, size_t size)> callback;
+
+
+private:
+
+	unsigned m_threads;
+	size_t m_window;
+	size_t m_maxsize;
+
+	const std::vector<std::wstring> *m_files = NULL;
+	callback m_fn;
+	std::atomic<size_t> m_next;
+	std::atomic<unsigned> m_slot;
+
+#ifdef _WIN32
+
+	static void reader(void *arg)
+	{
+		read_scheduler *self = static_cast<read_scheduler *>(arg);
+		unsigned slot = self->m_slot++;
+		std::vector<unsigned char> buf;
+		size_t i;
+
+		while ((i = self->m_next++) < self->m_files->size()) {
+			if (read_whole_file((*self->m_files)[i].c_str(), buf, self->m_maxsize)) {
+				self->m_fn(slot, i, buf.data(), buf.size());
+			} else {
+				self->m_fn(slot, i, NULL, 0);
+			}
+		}
+	}
+
+#else
+
+	struct entry
+	{
+		std::string path;
+		dev_t dev;
+		ino_t ino;
+		off_t size;    // -1 if stat() failed
+		size_t index;
+	};
+
+	struct pending
+	{
+		size_t index;
+		int fd;
+		size_t size;
+	};
+
+	// files are handed to the readers in groups to keep the queue overhead low
+	enum { GROUP = 16 };
+
+	struct group
+	{
+		pending files[GROUP];
+		size_t count;
+	};
+
+	std::vector<entry> m_order;
+	bounded_queue<group *> *m_queue = NULL;
+
+
+	static void stat_worker(void *arg)
+	{
+		read_scheduler *self = static_cast<read_scheduler *>(arg);
+		char bpath[4096];
+		struct stat st;
+		size_t i;
+
+		while ((i = self->m_next++) < self->m_order.size()) {
+			entry &e = self->m_order[i];
+
+			compat_wide_to_utf8((*self->m_files)[i].c_str(), bpath, sizeof(bpath));
+			e.path = bpath;
+			e.index = i;
+
+			if (stat(bpath, &st) == 0 && S_ISREG(st.st_mode)) {
+				e.dev = st.st_dev;
+				e.ino = st.st_ino;
+				e.size = st.st_size;
+			} else {
+				e.dev = 0;
+				e.ino = 0;
+				e.size = -1;
+			}
+		}
+	}
+
+	// open a file and ask the kernel to start reading it; fd is -1 on error
+	pending open_ahead(const entry &e) const
+	{
+		pending p = { e.index, -1, 0 };
+
+		if (e.size < 0 || static_cast<unsigned long long>(e.size) > m_maxsize) {
+			return p;
+		}
+
+		p.size = static_cast<size_t>(e.size);
+
+#ifdef O_NOATIME
+		// only allowed for the owner of the file
+		p.fd = open(e.path.c_str(), O_RDONLY | O_NOATIME);
+#endif
+		if (p.fd == -1) {
+			p.fd = open(e.path.c_str(), O_RDONLY);
+		}
+
+#ifdef POSIX_FADV_WILLNEED
+		if (p.fd != -1 && p.size > 0) {
+			posix_fadvise(p.fd, 0, static_cast<off_t>(p.size), POSIX_FADV_WILLNEED);
+		}
+#endif
+
+		return p;
+	}
+
+	// read a file opened by open_ahead() with one pread() and close it
+	void read_pending(unsigned slot, const pending &p, std::vector<unsigned char> &buf) const
+	{
+		size_t len = 0;
+		bool ok = (p.fd != -1);
+
+		if (ok) {
+			// one extra byte to notice files that grew since stat()
+			buf.resize(p.size + 1);
+
+			for (;;) {
+				ssize_t r = pread(p.fd, buf.data() + len, buf.size() - len, static_cast<off_t>(len));
+
+				if (r <= 0) {
+					ok = (r == 0);
+					break;
+				}
+
+				len += static_cast<size_t>(r);
+
+				// a short read of a regular file is its end; saves the
+				// second pread() that would only return 0
+				if (len < buf.size()) {
+					break;
+				}
+
+				if (buf.size() > m_maxsize) {
+					ok = false;
+					break;
+				}
+				buf.resize(std::min(buf.size() * 2, m_maxsize + 1));
+			}
+
+			close(p.fd);
+		}
+
+		if (ok) {
+			m_fn(slot, p.index, buf.data(), len);
+		} else {
+			m_fn(slot, p.index, NULL, 0);
+		}
+	}
+
+	static void reader(void *arg)
+	{
+		read_scheduler *self = static_cast<read_scheduler *>(arg);
+		unsigned slot = self->m_slot++;
+		std::vector<unsigned char> buf;
+		group *g;
+
+		while (self->m_queue->pop(g)) {
+			for (size_t i = 0; i < g->count; ++i) {
+				self->read_pending(slot, g->files[i], buf);
+			}
+			delete g;
+		}
+	}
+
+#endif // !_WIN32
+
+
+public:
+
+	// threads: number of reader threads;
+	// window: number of files opened and announced ahead of the readers
+	read_scheduler(unsigned threads = 8, size_t window = 128, size_t maxsize = 16*1024*1024)
+	: m_threads(threads ? threads : 1),
+	  m_window(window ? window : 1),
+	  m_maxsize(maxsize),
+	  m_next(0),
+	  m_slot(0)
+	{}
+
+	// number of different slot values passed to the callback
+	unsigned threads() const {
+		return m_threads;
+	}
+
+	// Read all files and call fn for each of them; returns when all calls
+	// have finished.
+	void run(const std::vector<std::wstring> &files, callback fn)
+	{
+		compat_thread *threads = new compat_thread[m_threads];
+		unsigned nstarted = 0;
+
+		m_files = &files;
+		m_fn = fn;
+		m_next = 0;
+		m_slot = 0;
+
+#ifdef _WIN32
+		for (unsigned i = 0; i < m_threads; ++i) {
+			if (threads[i].start(reader, this)) ++nstarted;
+		}
+
+		if (nstarted == 0) {
+			reader(this);
+		}
+#else
+		// stat in parallel, the inodes are spread over the disk as well
+		m_order.resize(files.size());
+
+		for (unsigned i = 0; i < m_threads; ++i) {
+			if (threads[i].start(stat_worker, this)) ++nstarted;
+		}
+
+		if (nstarted == 0) {
+			stat_worker(this);
+		}
+
+		for (unsigned i = 0; i < m_threads; ++i) {
+			threads[i].join();
+		}
+
+		std::sort(m_order.begin(), m_order.end(), [](const entry &a, const entry &b) {
+			return (a.dev != b.dev) ? a.dev < b.dev : a.ino < b.ino;
+		});
+
+		m_queue = new bounded_queue<group *>((m_window + GROUP - 1) / GROUP);
+		nstarted = 0;
+
+		for (unsigned i = 0; i < m_threads; ++i) {
+			if (threads[i].start(reader, this)) ++nstarted;
+		}
+
+		if (nstarted > 0) {
+			for (size_t i = 0; i < m_order.size(); i += GROUP) {
+				group *g = new group;
+				g->count = std::min<size_t>(GROUP, m_order.size() - i);
+
+				for (size_t j = 0; j < g->count; ++j) {
+					g->files[j] = open_ahead(m_order[i + j]);
+				}
+
+				m_queue->push(g);
+			}
+		} else {
+			std::vector<unsigned char> buf;
+
+			for (size_t i = 0; i < m_order.size(); ++i) {
+				read_pending(0, open_ahead(m_order[i]), buf);
+			}
+		}
+
+		m_queue->close();
+
+		for (unsigned i = 0; i < m_threads; ++i) {
+			threads[i].join();
+		}
+
+		delete m_queue;
+		m_queue = NULL;
+		std::vector<entry>().swap(m_order);
+#endif
+
+		delete[] threads;
+		m_files = NULL;
+		m_fn = callback();
+	}
+};
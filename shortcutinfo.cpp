@@ -28,60 +28,93 @@ SOFTWARE.
  *
  * Compile with MSVC:
  *   cl.exe -W3 -O2 -D_UNICODE shortcutinfo.cpp
+ *
+ * Compile natively on other systems (without COM, using the native parser only):
+ *   g++ -Wall -Wextra -O3 -o shortcutinfo shortcutinfo.cpp
  */
 
 #ifdef _MSC_VER
 #pragma comment(lib, "ole32.lib")
 //#pragma comment(lib, "shell32.lib")
 #endif
-#include <windows.h>
-#include <stdio.h>
-#include "shortcutinfo.hpp"
+#include "compat.hpp"
+#ifdef _WIN32
+# include "shortcutinfo.hpp"
+#endif
+#include "drivemap.hpp"
+#include "filelist.hpp"
+#include "lnkcarve.hpp"
+#include "lnkdesktop.hpp"
+#include "lnkparser.hpp"
+#include "lnkresolve.hpp"
+#include "lnkstats.hpp"
+#include "lnkstream.hpp"
 
 
-int wmain(int argc, wchar_t *argv[])
+// print hotkey modifiers as " [MODIFIER] ..."
+static void print_modifiers(unsigned char hi)
 {
-	WORD wHotkey = 0;
-	DWORD dwFlags = 0;
-	const wchar_t *p = NULL;
-	int n = 0;
+	if (hi & HOTKEYF_CONTROL) wprintf_s(L" [CTRL]");
+	if (hi & HOTKEYF_SHIFT) wprintf_s(L" [SHIFT]");
+	if (hi & HOTKEYF_ALT) wprintf_s(L" [ALT]");
+	if (hi & HOTKEYF_EXT) wprintf_s(L" [EXT]");
+}
 
-	if (argc < 2) {
-		wprintf_s(L"Shows information about Shell Links\n"
-					"usage: %s FILENAME\n", argv[0]);
-		return 0;
-	}
 
-	const wchar_t *filename = argv[1];
-	shell_link_info shl(filename);
+// print a hotkey as " [MODIFIER] ... [KEY]"
+static void print_hotkey(WORD wHotkey)
+{
+	unsigned char lo = wHotkey & 0xff;
 
-	if (!shl.load_file()) {
-		wprintf_s(L"%s: failed to load file: %s\n", argv[0], filename);
-		return 1;
+	print_modifiers((wHotkey >> 8) & 0xff);
+
+	if ((lo >= 'A' && lo <= 'Z') || (lo >= '0' && lo <= '9')) {
+		wprintf_s(L" [%c]", lo);
+	} else if (lo >= VK_F1 && lo <= VK_F24) {
+		wprintf_s(L" [F%d]", lo - (VK_F1 - 1));
+	} else if (lo == VK_NUMLOCK) {
+		wprintf_s(L" [NUMLOCK]");
+	} else if (lo == VK_SCROLL) {
+		wprintf_s(L" [SCROLL]");
+	} else if (lo == 0x00) {
+		wprintf_s(L" [0x00 (not set)]");
+	} else {
+		wprintf_s(L" [0x%02X (not supported)]", lo);
 	}
+}
+
+
+// works with shell_link_info (COM) and shell_link_parser (native)
+template<class T>
+static void print_info(T &shl)
+{
+	WORD wHotkey = 0;
+	DWORD dwFlags = 0;
+	const wchar_t *p = NULL;
+	int n = 0;
 
 	if ((p = shl.get_path()) != NULL) {
-		wprintf_s(L"Target path: %s\n", p);
+		wprintf_s(L"Target path: %ls\n", p);
 	}
 
 	//if ((p = shl.get_clsid()) != NULL) {
-	//	wprintf_s(L"CLSID: %s\n", p);
+	//	wprintf_s(L"CLSID: %ls\n", p);
 	//}
 
 	if ((p = shl.get_arguments()) != NULL) {
-		wprintf_s(L"Arguments: %s\n", p);
+		wprintf_s(L"Arguments: %ls\n", p);
 	}
 
 	if ((p = shl.get_description()) != NULL) {
-		wprintf_s(L"Description: %s\n", p);
+		wprintf_s(L"Description: %ls\n", p);
 	}
 
 	if ((p = shl.get_iconlocation(n)) != NULL) {
-		wprintf_s(L"Icon location: %s\nIcon index: %d\n", p, n);
+		wprintf_s(L"Icon location: %ls\nIcon index: %d\n", p, n);
 	}
 
 	if ((p = shl.get_workingdir()) != NULL) {
-		wprintf_s(L"Working directory: %s\n", p);
+		wprintf_s(L"Working directory: %ls\n", p);
 	}
 
 	if (shl.get_showcmd(n)) {
@@ -105,37 +138,460 @@ int wmain(int argc, wchar_t *argv[])
 	}
 
 	if (shl.get_hotkey(wHotkey) && wHotkey != 0) {
-		unsigned char hi = (wHotkey >> 8) & 0xff;
-		unsigned char lo = wHotkey & 0xff;
-
 		wprintf_s(L"Hotkey:");
+		print_hotkey(wHotkey);
+		wprintf_s(L" (0x%X)\n", wHotkey);
+	}
+
+	if (shl.get_flags(dwFlags)) {
+		wprintf_s(L"Run as Administrator: %ls\n",
+					(dwFlags & SLDF_RUNAS_USER) ? L"yes" : L"no");
+	}
+}
+
+
+// print all Shell Links found in an archive or piped through stdin
+static int stream_info(const wchar_t *prog, const wchar_t *input)
+{
+	archive_reader reader;
+	shell_link_parser *shl = new shell_link_parser;
+	FILE *fp = stdin;
+	const char *name = NULL;
+	const unsigned char *data = NULL;
+	size_t size = 0;
+	wchar_t wname[4096];
+	int ret = 0;
+	int rv;
+
+	if (input && wcscmp(input, L"-") != 0) {
+		fp = compat_wfopen(input, L"rb");
+
+		if (!fp) {
+			wprintf_s(L"%ls: failed to open file: %ls\n", prog, input);
+			delete shl;
+			return 1;
+		}
+	} else {
+		compat_set_binary(stdin);
+	}
+
+	if (!reader.open(fp)) {
+		wprintf_s(L"%ls: %ls\n", prog, reader.error());
+		ret = 1;
+	}
+
+	while (ret == 0 && (rv = reader.next(name, data, size)) != archive_reader::MEMBER_END) {
+		if (rv == archive_reader::MEMBER_ERROR) {
+			wprintf_s(L"%ls: %ls\n", prog, reader.error());
+			ret = 1;
+			break;
+		}
 
-		if (hi & HOTKEYF_CONTROL) wprintf_s(L" [CTRL]");
-		if (hi & HOTKEYF_SHIFT) wprintf_s(L" [SHIFT]");
-		if (hi & HOTKEYF_ALT) wprintf_s(L" [ALT]");
-		if (hi & HOTKEYF_EXT) wprintf_s(L" [EXT]");
-
-		if ((lo >= 'A' && lo <= 'Z') || (lo >= '0' && lo <= '9')) {
-			wprintf_s(L" [%c]", lo);
-		} else if (lo >= VK_F1 && lo <= VK_F24) {
-			wprintf_s(L" [F%d]", lo - (VK_F1 - 1));
-		} else if (lo == VK_NUMLOCK) {
-			wprintf_s(L" [NUMLOCK]");
-		} else if (lo == VK_SCROLL) {
-			wprintf_s(L" [SCROLL]");
-		} else if (lo == 0x00) {
-			wprintf_s(L" [0x00 (not set)]");
+		compat_utf8_to_wide(name, strlen(name), wname, _countof(wname));
+		wprintf_s(L"Member: %ls\n", wname);
+
+		if (rv == archive_reader::MEMBER_TOO_LARGE) {
+			wprintf_s(L"Skipped: member too large\n\n");
+		} else if (rv == archive_reader::MEMBER_UNSUPPORTED) {
+			wprintf_s(L"Skipped: unsupported compression method or encrypted member\n\n");
+		} else if (rv == archive_reader::MEMBER_CORRUPT) {
+			wprintf_s(L"Skipped: invalid compressed data\n\n");
+		} else if (!shl->load(data, size)) {
+			wprintf_s(L"Skipped: not a valid Shell Link\n\n");
 		} else {
-			wprintf_s(L" [0x%02X (not supported)]", lo);
+			print_info(*shl);
+			wprintf_s(L"\n");
 		}
+	}
 
-		wprintf_s(L" (0x%X)\n", wHotkey);
+	if (fp != stdin) {
+		fclose(fp);
 	}
 
-	if (shl.get_flags(dwFlags)) {
-		wprintf_s(L"Run as Administrator: %s\n",
-					(dwFlags & SLDF_RUNAS_USER) ? L"yes" : L"no");
+	delete shl;
+
+	return ret;
+}
+
+
+// recover Shell Links from a disk image or memory dump
+static int carve_info(const wchar_t *prog, const wchar_t *image)
+{
+	lnk_carver carver;
+	shell_link_parser *shl = new shell_link_parser;
+
+	if (!image || !carver.open(image)) {
+		wprintf_s(L"%ls: failed to open file: %ls\n", prog, image ? image : L"(none)");
+		delete shl;
+		return 1;
+	}
+
+	carver.run();
+
+	const std::vector<carved_link> &found = carver.results();
+
+	for (size_t i = 0; i < found.size(); ++i) {
+		wprintf_s(L"Offset: 0x%llX (%llu bytes)\n",
+					found[i].offset, static_cast<unsigned long long>(found[i].size));
+
+		if (shl->load(carver.data(found[i]), found[i].size)) {
+			print_info(*shl);
+		}
+
+		wprintf_s(L"\n");
 	}
 
+	wprintf_s(L"%llu Shell Link(s) recovered\n", static_cast<unsigned long long>(found.size()));
+
+	delete shl;
+
 	return 0;
 }
+
+
+// Parse the "/drive:PREFIX=DIR", "/depth:N" and "/top:N" options (each only
+// if a pointer for it was given) and collect the remaining arguments as
+// files or directories in inputs.
+static bool parse_bulk_args(const wchar_t *prog, int argc, wchar_t *argv[], drive_map *drives,
+							unsigned *depth, unsigned *top, std::vector<const wchar_t *> &inputs)
+{
+	for (int i = 0; i < argc; ++i) {
+		const wchar_t *a = argv[i];
+
+		if (drives && (a[0] == L'/' || a[0] == L'-') && _wcsnicmp(a+1, L"drive", 5) == 0 &&
+			(a[6] == L':' || a[6] == L'='))
+		{
+			if (!drives->add(a+7)) {
+				wprintf_s(L"%ls: invalid drive mapping: %ls\n", prog, a+7);
+				return false;
+			}
+			continue;
+		}
+
+		if (depth && (a[0] == L'/' || a[0] == L'-') && _wcsnicmp(a+1, L"depth", 5) == 0 &&
+			(a[6] == L':' || a[6] == L'='))
+		{
+			if (swscanf_s(a+7, L"%u", depth) != 1 || *depth == 0) {
+				wprintf_s(L"%ls: invalid depth: %ls\n", prog, a+7);
+				return false;
+			}
+			continue;
+		}
+
+		if (top && (a[0] == L'/' || a[0] == L'-') && _wcsnicmp(a+1, L"top", 3) == 0 &&
+			(a[4] == L':' || a[4] == L'='))
+		{
+			if (swscanf_s(a+5, L"%u", top) != 1 || *top == 0) {
+				wprintf_s(L"%ls: invalid number: %ls\n", prog, a+5);
+				return false;
+			}
+			continue;
+		}
+
+		inputs.push_back(a);
+	}
+
+	if (inputs.empty()) {
+		wprintf_s(L"%ls: no Shell Links given\n", prog);
+		return false;
+	}
+
+	return true;
+}
+
+
+// collect the Shell Links in all inputs (files or directories)
+static bool collect_bulk_files(const wchar_t *prog, const std::vector<const wchar_t *> &inputs,
+								std::vector<std::wstring> &files)
+{
+	for (size_t i = 0; i < inputs.size(); ++i) {
+		if (!collect_lnk_files(inputs[i], files)) {
+			wprintf_s(L"%ls: no such file or directory: %ls\n", prog, inputs[i]);
+			return false;
+		}
+	}
+
+	if (files.empty()) {
+		wprintf_s(L"%ls: no Shell Links given\n", prog);
+		return false;
+	}
+
+	return true;
+}
+
+
+// follow link-to-link chains to their final targets
+static int resolve_info(const wchar_t *prog, int argc, wchar_t *argv[])
+{
+	drive_map drives;
+	unsigned depth = 32;
+	std::vector<const wchar_t *> inputs;
+	std::vector<std::wstring> files;
+	std::vector<resolve_result> results;
+	int ret = 0;
+
+	if (!parse_bulk_args(prog, argc, argv, &drives, &depth, NULL, inputs) ||
+		!collect_bulk_files(prog, inputs, files))
+	{
+		return 1;
+	}
+
+	lnk_resolver *resolver = new lnk_resolver(drives, depth);
+	resolver->run(files, results);
+	delete resolver;
+
+	for (size_t i = 0; i < files.size(); ++i) {
+		const resolve_result &r = results[i];
+
+		switch (r.status)
+		{
+		case resolve_result::RESOLVE_OK:
+			wprintf_s(L"%ls -> %ls (%u link(s))\n", files[i].c_str(), r.target.c_str(), r.hops);
+			break;
+		case resolve_result::RESOLVE_NO_TARGET:
+			wprintf_s(L"%ls: no target path (%u link(s))\n", files[i].c_str(), r.hops);
+			break;
+		case resolve_result::RESOLVE_CYCLE:
+			wprintf_s(L"%ls: cycle detected at %ls\n", files[i].c_str(), r.target.c_str());
+			ret = 1;
+			break;
+		case resolve_result::RESOLVE_DEPTH:
+			wprintf_s(L"%ls: more than %u links, stopped at %ls\n", files[i].c_str(), depth, r.target.c_str());
+			ret = 1;
+			break;
+		default:
+			wprintf_s(L"%ls: failed to load file: %ls\n", files[i].c_str(), r.target.c_str());
+			ret = 1;
+			break;
+		}
+	}
+
+	return ret;
+}
+
+
+// convert Shell Links into desktop entries in outdir
+static int desktop_info(const wchar_t *prog, const wchar_t *outdir, int argc, wchar_t *argv[])
+{
+	drive_map drives;
+	std::vector<const wchar_t *> inputs;
+	std::vector<std::wstring> files;
+	std::vector<int> status;
+	size_t converted = 0;
+	int ret = 0;
+
+	if (!parse_bulk_args(prog, argc, argv, &drives, NULL, NULL, inputs) ||
+		!collect_bulk_files(prog, inputs, files))
+	{
+		return 1;
+	}
+
+	desktop_converter *conv = new desktop_converter(drives, outdir);
+
+	if (!conv->run(files, status)) {
+		wprintf_s(L"%ls: failed to start worker threads\n", prog);
+		delete conv;
+		return 1;
+	}
+
+	for (size_t i = 0; i < files.size(); ++i) {
+		switch (status[i])
+		{
+		case desktop_converter::CONVERT_OK:
+			++converted;
+			break;
+		case desktop_converter::CONVERT_READ_ERROR:
+			wprintf_s(L"%ls: failed to load file: %ls\n", prog, files[i].c_str());
+			ret = 1;
+			break;
+		case desktop_converter::CONVERT_PARSE_ERROR:
+			wprintf_s(L"%ls: not a valid Shell Link: %ls\n", prog, files[i].c_str());
+			ret = 1;
+			break;
+		case desktop_converter::CONVERT_NO_TARGET:
+			wprintf_s(L"%ls: no target path: %ls\n", prog, files[i].c_str());
+			ret = 1;
+			break;
+		default:
+			wprintf_s(L"%ls: failed to write %ls.desktop\n", prog, conv->name(i).c_str());
+			ret = 1;
+			break;
+		}
+	}
+
+	wprintf_s(L"%llu of %llu Shell Link(s) converted\n",
+				static_cast<unsigned long long>(converted),
+				static_cast<unsigned long long>(files.size()));
+
+	delete conv;
+
+	return ret;
+}
+
+
+// aggregate statistics over a large number of Shell Links
+static int summary_info(const wchar_t *prog, int argc, wchar_t *argv[])
+{
+	unsigned top = 20;
+	std::vector<const wchar_t *> inputs;
+	std::vector<const wchar_t *> missing;
+	unsigned long long collided = 0;
+	int ret = 0;
+
+	if (!parse_bulk_args(prog, argc, argv, NULL, NULL, &top, inputs)) {
+		return 1;
+	}
+
+	// enough counters that the reported top entries are reliable
+	link_summary *summary = new link_summary(std::max<size_t>(top * 10, 1000));
+
+	summary->run(inputs, missing);
+
+	for (size_t i = 0; i < missing.size(); ++i) {
+		wprintf_s(L"%ls: no such file or directory: %ls\n", prog, missing[i]);
+		ret = 1;
+	}
+
+	const link_stats &st = summary->stats();
+	unsigned long long hotkeys = st.collisions(collided);
+
+	wprintf_s(L"Shell Links: %llu\n", st.links);
+	wprintf_s(L"Failed to load: %llu\n", st.failed);
+	wprintf_s(L"Without target path: %llu\n", st.no_target);
+	wprintf_s(L"Distinct targets: ~%llu\n", st.targets.estimate());
+	wprintf_s(L"With icon location: %llu\n", st.with_icon);
+	wprintf_s(L"Distinct icon locations: ~%llu\n", st.icons.estimate());
+	wprintf_s(L"Run as Administrator: %llu\n", st.runas);
+	wprintf_s(L"Show command: SW_SHOWNORMAL %llu, SW_SHOWMAXIMIZED %llu, "
+				"SW_SHOWMINNOACTIVE %llu, other %llu\n",
+				st.showcmd[link_stats::SHOW_NORMAL], st.showcmd[link_stats::SHOW_MAXIMIZED],
+				st.showcmd[link_stats::SHOW_MINNOACTIVE], st.showcmd[link_stats::SHOW_OTHER]);
+	wprintf_s(L"With hotkey: %llu\n", st.with_hotkey);
+
+	for (unsigned i = 0; i < 16; ++i) {
+		if (st.modifiers[i] == 0) {
+			continue;
+		}
+
+		wprintf_s(L"  %llu with modifiers", st.modifiers[i]);
+		if (i == 0) wprintf_s(L" [none]");
+		print_modifiers(static_cast<unsigned char>(i));
+		wprintf_s(L"\n");
+	}
+
+	wprintf_s(L"Hotkeys used by more than one link: %llu (%llu links)\n", hotkeys, collided);
+
+	for (size_t i = 0; i < st.hotkeys.size(); ++i) {
+		if (st.hotkeys[i] > 1) {
+			wprintf_s(L" ");
+			print_hotkey(static_cast<WORD>(i));
+			wprintf_s(L" (0x%X): %u links\n", static_cast<unsigned>(i), st.hotkeys[i]);
+		}
+	}
+
+	std::vector<space_saving::entry> common = st.top_targets.top(top);
+
+	wprintf_s(L"Most common targets:\n");
+
+	for (size_t i = 0; i < common.size(); ++i) {
+		if (common[i].error > 0) {
+			wprintf_s(L"  %llu (at least %llu) %ls\n", common[i].count,
+						common[i].count - common[i].error, common[i].key.c_str());
+		} else {
+			wprintf_s(L"  %llu %ls\n", common[i].count, common[i].key.c_str());
+		}
+	}
+
+	delete summary;
+
+	return ret;
+}
+
+
+int wmain(int argc, wchar_t *argv[])
+{
+	if (argc < 2) {
+		wprintf_s(L"Shows information about Shell Links\n"
+					"usage: %ls FILENAME\n"
+					"       %ls /stream [ARCHIVE]\n"
+					"       %ls /carve IMAGE\n"
+					"       %ls /resolve [/drive:PREFIX=DIR ...] [/depth:N] FILE|DIR ...\n"
+					"       %ls /desktop:OUTDIR [/drive:PREFIX=DIR ...] FILE|DIR ...\n"
+					"       %ls /summary [/top:N] FILE|DIR ...\n"
+					"\n"
+					"  /stream   Read Shell Links from a tar or zip archive (or a single\n"
+					"            Shell Link) in one sequential pass; reads from stdin\n"
+					"            if ARCHIVE is omitted or '-'\n"
+					"  /carve    Recover Shell Links from raw data such as disk images\n"
+					"            or memory dumps and print them with their offsets\n"
+					"  /resolve  Follow Shell Links that point to other Shell Links to the\n"
+					"            final target; directories are searched for .lnk files,\n"
+					"            cycles and chains longer than N (default 32) are reported\n"
+					"  /desktop  Convert Shell Links into desktop entries for Wine and\n"
+					"            save them in OUTDIR (which must exist)\n"
+					"  /summary  Print statistics over all given Shell Links (targets,\n"
+					"            hotkeys, show commands, ...) and the N (default 20)\n"
+					"            most common targets; distinct counts are estimates\n"
+					"  /drive    Map a Windows path prefix to a local directory, e.g.\n"
+					"            /drive:C:=/home/user/.wine/drive_c\n",
+					argv[0], argv[0], argv[0], argv[0], argv[0], argv[0]);
+		return 0;
+	}
+
+	const wchar_t *a = argv[1];
+
+	if ((a[0] == L'/' || a[0] == L'-') && _wcsicmp(a+1, L"stream") == 0) {
+		return stream_info(argv[0], (argc > 2) ? argv[2] : NULL);
+	}
+
+	if ((a[0] == L'/' || a[0] == L'-') && _wcsicmp(a+1, L"carve") == 0) {
+		return carve_info(argv[0], (argc > 2) ? argv[2] : NULL);
+	}
+
+	if ((a[0] == L'/' || a[0] == L'-') && _wcsicmp(a+1, L"resolve") == 0) {
+		return resolve_info(argv[0], argc - 2, argv + 2);
+	}
+
+	if ((a[0] == L'/' || a[0] == L'-') && _wcsicmp(a+1, L"summary") == 0) {
+		return summary_info(argv[0], argc - 2, argv + 2);
+	}
+
+	if ((a[0] == L'/' || a[0] == L'-') && _wcsnicmp(a+1, L"desktop", 7) == 0 &&
+		(a[8] == L':' || a[8] == L'=') && a[9] != 0)
+	{
+		return desktop_info(argv[0], a+9, argc - 2, argv + 2);
+	}
+
+	const wchar_t *filename = argv[1];
+
+#ifdef _WIN32
+	shell_link_info shl(filename);
+
+	if (!shl.load_file()) {
+		wprintf_s(L"%ls: failed to load file: %ls\n", argv[0], filename);
+		return 1;
+	}
+
+	print_info(shl);
+#else
+	shell_link_parser *shl = new shell_link_parser;
+
+	if (!shl->load_file(filename)) {
+		wprintf_s(L"%ls: failed to load file: %ls\n", argv[0], filename);
+		delete shl;
+		return 1;
+	}
+
+	print_info(*shl);
+	delete shl;
+#endif
+
+	return 0;
+}
+
+#ifndef _WIN32
+int main(int argc, char *argv[])
+{
+	return compat_main(argc, argv, wmain);
+}
+#endif